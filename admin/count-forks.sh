@@ -0,0 +1,124 @@
+#! /bin/sh
+# Copyright (c) 2026 The NetBSD Foundation, Inc.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+# 1. Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+# 2. Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#
+# THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+# CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+# INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+# IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+# DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+# GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+# INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+# IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+# IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#
+# A utility to count the processes that an atf-sh test program creates when
+# listing its test cases and when running each of them.  This is meant to
+# spot regressions in the number of forks done by libatf-sh, which are very
+# expensive on emulated platforms.
+#
+# The counts are exact when strace(1) is available.  Otherwise they are
+# taken from the system-wide counter of created processes in /proc/stat, so
+# the system should be otherwise idle.
+#
+
+Prog_Name=${0##*/}
+
+#
+# err message
+#
+err() {
+    echo "${Prog_Name}: ${@}" 1>&2
+    exit 1
+}
+
+#
+# processes
+#
+# Stores in processes_count the number of processes created since boot.
+#
+processes() {
+    while read -r key value; do
+        if [ "${key}" = processes ]; then
+            processes_count=${value}
+            return 0
+        fi
+    done </proc/stat
+    err "Cannot find the process counter in /proc/stat"
+}
+
+#
+# count command [args]
+#
+# Runs the given command and prints the number of forks it did, not
+# counting the one needed to start it.
+#
+count() {
+    if [ -n "${strace}" ]; then
+        "${strace}" -f -qq -o "${workdir}/trace" \
+            -e trace=fork,vfork,clone,clone3 "${@}" >/dev/null 2>&1
+        grep -c -E '(fork|clone3?)\(' "${workdir}/trace"
+        rm -f "${workdir}/trace"
+    else
+        processes; before=${processes_count}
+        "${@}" >/dev/null 2>&1
+        processes; after=${processes_count}
+        echo $((after - before - 1))
+    fi
+}
+
+#
+# main test-program [test-case ...]
+#
+# Entry point.
+#
+main() {
+    [ ${#} -ge 1 ] || err "Usage: ${Prog_Name} test-program [test-case ...]"
+    program="${1}"; shift
+    case "${program}" in
+        /*) ;;
+        *) program="$(pwd)/${program}" ;;
+    esac
+    [ -x "${program}" ] || err "Cannot execute ${program}"
+
+    strace=$(command -v strace)
+    if [ -z "${strace}" -a ! -r /proc/stat ]; then
+        err "Need strace(1) or /proc/stat to count forks"
+    fi
+
+    srcdir="${program%/*}"
+    workdir=$(mktemp -d "${TMPDIR:-/tmp}/count-forks.XXXXXX") || \
+        err "Cannot create a work directory"
+    trap 'rm -rf "${workdir}"' EXIT
+    cd "${workdir}"
+
+    export __RUNNING_INSIDE_ATF_RUN=internal-yes-value
+
+    if [ ${#} -eq 0 ]; then
+        set -- $("${program}" -s "${srcdir}" -l | sed -n 's/^ident: //p')
+    fi
+
+    echo "-l: $(count "${program}" -s "${srcdir}" -l)"
+    for tc in "${@}"; do
+        mkdir "${tc}"
+        echo "${tc}: $(cd "${tc}" && count "${program}" -s "${srcdir}" \
+            -r "${workdir}/result" "${tc}")"
+    done
+}
+
+main "${@}"
+
+# vim: syntax=sh:expandtab:shiftwidth=4:softtabstop=4
@@ -0,0 +1,337 @@
+// Copyright (c) 2026 The NetBSD Foundation, Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+// CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+// INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+// IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+// IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "atf-c++/detail/diff.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "atf-c++/detail/sanity.hpp"
+
+namespace impl = atf::diff;
+#define IMPL_NAME "atf::diff"
+
+namespace {
+
+// Number of unchanged lines shown around each change.
+static const std::size_t context_lines = 3;
+
+// Maximum number of edits that the Myers algorithm explores before giving
+// up on finding the shortest edit script.  This bounds its memory usage,
+// which is quadratic in this value.
+static const int max_edits = 1024;
+
+struct line {
+    const char* m_text;
+    std::size_t m_length;
+    bool m_newline;
+
+    line(const char* text, const std::size_t length, const bool newline) :
+        m_text(text),
+        m_length(length),
+        m_newline(newline)
+    {
+    }
+
+    bool
+    operator==(const line& other)
+        const
+    {
+        return m_length == other.m_length && m_newline == other.m_newline &&
+            std::memcmp(m_text, other.m_text, m_length) == 0;
+    }
+};
+
+enum op_type {
+    op_equal,
+    op_delete,
+    op_insert,
+};
+
+// A step of the edit script, referring to a line of the old text for
+// op_equal and op_delete and to a line of the new text for op_insert.
+struct op {
+    op_type m_type;
+    std::size_t m_line;
+
+    op(const op_type type, const std::size_t l) :
+        m_type(type),
+        m_line(l)
+    {
+    }
+};
+
+static
+std::vector< line >
+split_lines(const std::string& text)
+{
+    std::vector< line > lines;
+
+    const char* pos = text.data();
+    const char* const end = pos + text.length();
+    while (pos < end) {
+        const char* eol = static_cast< const char* >(
+            std::memchr(pos, '\n', end - pos));
+        if (eol == NULL) {
+            lines.push_back(line(pos, end - pos, false));
+            break;
+        }
+        lines.push_back(line(pos, eol - pos, true));
+        pos = eol + 1;
+    }
+
+    return lines;
+}
+
+// Computes the edit script that turns a[a0..a1) into b[b0..b1), appending it
+// to ops.  Returns false if the shortest script needs more than max_edits
+// edits, in which case ops is left untouched.
+static
+bool
+myers(const std::vector< line >& a, const std::size_t a0, const std::size_t a1,
+      const std::vector< line >& b, const std::size_t b0, const std::size_t b1,
+      std::vector< op >& ops)
+{
+    const int n = static_cast< int >(a1 - a0);
+    const int m = static_cast< int >(b1 - b0);
+    const int dmax = std::min(n + m, max_edits);
+
+    // v[k + offset] holds the furthest x reached on diagonal k.  trace[d]
+    // keeps the diagonals -d-1..d+1 of v as they were before step d.
+    const int offset = dmax + 1;
+    std::vector< int > v(2 * dmax + 3, 0);
+    std::vector< std::vector< int > > trace;
+
+    int d;
+    bool found = false;
+    for (d = 0; !found && d <= dmax; d++) {
+        trace.push_back(std::vector< int >(v.begin() + offset - d - 1,
+                                           v.begin() + offset + d + 2));
+
+        for (int k = -d; !found && k <= d; k += 2) {
+            int x;
+            if (k == -d || (k != d && v[offset + k - 1] < v[offset + k + 1]))
+                x = v[offset + k + 1];
+            else
+                x = v[offset + k - 1] + 1;
+            int y = x - k;
+
+            while (x < n && y < m && a[a0 + x] == b[b0 + y]) {
+                x++;
+                y++;
+            }
+            v[offset + k] = x;
+
+            if (x >= n && y >= m)
+                found = true;
+        }
+    }
+    if (!found)
+        return false;
+
+    std::vector< op > script;
+    int x = n, y = m;
+    for (d = static_cast< int >(trace.size()) - 1; d >= 0; d--) {
+        const std::vector< int >& tv = trace[d];
+        const int toff = d + 1;
+        const int k = x - y;
+
+        int prev_k;
+        if (k == -d || (k != d && tv[toff + k - 1] < tv[toff + k + 1]))
+            prev_k = k + 1;
+        else
+            prev_k = k - 1;
+        const int prev_x = tv[toff + prev_k];
+        const int prev_y = prev_x - prev_k;
+
+        while (x > prev_x && y > prev_y) {
+            x--;
+            y--;
+            script.push_back(op(op_equal, a0 + x));
+        }
+        if (d > 0) {
+            if (x == prev_x)
+                script.push_back(op(op_insert, b0 + prev_y));
+            else
+                script.push_back(op(op_delete, a0 + prev_x));
+        }
+        x = prev_x;
+        y = prev_y;
+    }
+
+    ops.insert(ops.end(), script.rbegin(), script.rend());
+    return true;
+}
+
+static
+std::vector< op >
+edit_script(const std::vector< line >& a, const std::vector< line >& b)
+{
+    std::size_t prefix = 0;
+    while (prefix < a.size() && prefix < b.size() && a[prefix] == b[prefix])
+        prefix++;
+
+    std::size_t suffix = 0;
+    while (suffix < a.size() - prefix && suffix < b.size() - prefix &&
+           a[a.size() - suffix - 1] == b[b.size() - suffix - 1])
+        suffix++;
+
+    std::vector< op > ops;
+    for (std::size_t i = 0; i < prefix; i++)
+        ops.push_back(op(op_equal, i));
+
+    const std::size_t a1 = a.size() - suffix, b1 = b.size() - suffix;
+    if (!myers(a, prefix, a1, b, prefix, b1, ops)) {
+        for (std::size_t i = prefix; i < a1; i++)
+            ops.push_back(op(op_delete, i));
+        for (std::size_t i = prefix; i < b1; i++)
+            ops.push_back(op(op_insert, i));
+    }
+
+    for (std::size_t i = a1; i < a.size(); i++)
+        ops.push_back(op(op_equal, i));
+
+    return ops;
+}
+
+static
+void
+print_range(std::ostream& os, const std::size_t start,
+            const std::size_t count)
+{
+    if (count == 1)
+        os << start;
+    else if (count == 0)
+        os << (start - 1) << ",0";
+    else
+        os << start << "," << count;
+}
+
+static
+void
+print_line(std::ostream& os, const char prefix, const line& l)
+{
+    os << prefix;
+    os.write(l.m_text, l.m_length);
+    os << "\n";
+    if (!l.m_newline)
+        os << "\\ No newline at end of file\n";
+}
+
+} // anonymous namespace
+
+// ------------------------------------------------------------------------
+// Free functions.
+// ------------------------------------------------------------------------
+
+void
+impl::unified(std::ostream& os, const std::string& old_label,
+              const std::string& old_text, const std::string& new_label,
+              const std::string& new_text, const std::size_t max_lines)
+{
+    if (old_text == new_text)
+        return;
+
+    const std::vector< line > a = split_lines(old_text);
+    const std::vector< line > b = split_lines(new_text);
+    const std::vector< op > ops = edit_script(a, b);
+
+    os << "--- " << old_label << "\n";
+    os << "+++ " << new_label << "\n";
+
+    // Line numbers, counted from 1, of the next op in each text.
+    std::size_t old_line = 1, new_line = 1;
+    std::size_t printed = 0;
+
+    std::size_t i = 0;
+    while (i < ops.size()) {
+        if (ops[i].m_type == op_equal) {
+            old_line++;
+            new_line++;
+            i++;
+            continue;
+        }
+
+        // Extend the hunk until the next change is too far away to share
+        // its context with this one.
+        std::size_t last = i;
+        for (std::size_t j = i + 1; j < ops.size() &&
+             j - last <= 2 * context_lines + 1; j++) {
+            if (ops[j].m_type != op_equal)
+                last = j;
+        }
+
+        const std::size_t lead = std::min(i, context_lines);
+        const std::size_t first = i - lead;
+        const std::size_t end = std::min(ops.size(),
+                                         last + 1 + context_lines);
+
+        std::size_t old_count = 0, new_count = 0;
+        for (std::size_t j = first; j < end; j++) {
+            if (ops[j].m_type != op_insert)
+                old_count++;
+            if (ops[j].m_type != op_delete)
+                new_count++;
+        }
+
+        os << "@@ -";
+        print_range(os, old_line - lead, old_count);
+        os << " +";
+        print_range(os, new_line - lead, new_count);
+        os << " @@\n";
+
+        for (std::size_t j = first; j < end; j++) {
+            if (printed == max_lines) {
+                os << "[... differences truncated after " << printed
+                   << " lines ...]\n";
+                return;
+            }
+            printed++;
+
+            switch (ops[j].m_type) {
+            case op_equal:
+                print_line(os, ' ', a[ops[j].m_line]);
+                break;
+            case op_delete:
+                print_line(os, '-', a[ops[j].m_line]);
+                break;
+            case op_insert:
+                print_line(os, '+', b[ops[j].m_line]);
+                break;
+            default:
+                UNREACHABLE;
+            }
+        }
+
+        for (std::size_t j = i; j < end; j++) {
+            if (ops[j].m_type != op_insert)
+                old_line++;
+            if (ops[j].m_type != op_delete)
+                new_line++;
+        }
+        i = end;
+    }
+}
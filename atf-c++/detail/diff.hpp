@@ -0,0 +1,58 @@
+// Copyright (c) 2026 The NetBSD Foundation, Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+// CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+// INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+// IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+// IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#if !defined(ATF_CXX_DETAIL_DIFF_HPP)
+#define ATF_CXX_DETAIL_DIFF_HPP
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+namespace atf {
+namespace diff {
+
+// ------------------------------------------------------------------------
+// Free functions.
+// ------------------------------------------------------------------------
+
+//!
+//! \brief Prints the differences between two texts in unified format.
+//!
+//! The output follows the format of diff -u, with three lines of context
+//! around each change and the given labels in place of file names.  Nothing
+//! is printed if the texts are equal.  At most max_lines lines of hunks are
+//! printed; the rest of the differences are summarized in a single line.
+//!
+//! The differences are computed with the Myers algorithm.  Changes that
+//! are too costly to minimize are shown as a full replacement of the
+//! changed region instead.
+//!
+void unified(std::ostream&, const std::string&, const std::string&,
+             const std::string&, const std::string&, const std::size_t);
+
+} // namespace diff
+} // namespace atf
+
+#endif // !defined(ATF_CXX_DETAIL_DIFF_HPP)
@@ -0,0 +1,198 @@
+// Copyright (c) 2026 The NetBSD Foundation, Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+// CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+// INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+// IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+// IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "atf-c++/detail/diff.hpp"
+
+#include <sstream>
+
+#include <atf-c++.hpp>
+
+// ------------------------------------------------------------------------
+// Auxiliary functions.
+// ------------------------------------------------------------------------
+
+static
+std::string
+diff(const std::string& old_text, const std::string& new_text,
+     const std::size_t max_lines = 1000)
+{
+    std::ostringstream os;
+    atf::diff::unified(os, "old", old_text, "new", new_text, max_lines);
+    return os.str();
+}
+
+static
+std::string
+numbers(const int first, const int last)
+{
+    std::ostringstream os;
+    for (int i = first; i <= last; i++)
+        os << i << "\n";
+    return os.str();
+}
+
+// ------------------------------------------------------------------------
+// Test cases for the free functions.
+// ------------------------------------------------------------------------
+
+ATF_TEST_CASE(unified_equal);
+ATF_TEST_CASE_HEAD(unified_equal)
+{
+    set_md_var("descr", "Tests that nothing is printed for equal texts");
+}
+ATF_TEST_CASE_BODY(unified_equal)
+{
+    ATF_REQUIRE_EQ("", diff("", ""));
+    ATF_REQUIRE_EQ("", diff("foo\nbar\n", "foo\nbar\n"));
+}
+
+ATF_TEST_CASE(unified_change);
+ATF_TEST_CASE_HEAD(unified_change)
+{
+    set_md_var("descr", "Tests the diff of a changed line");
+}
+ATF_TEST_CASE_BODY(unified_change)
+{
+    ATF_REQUIRE_EQ("--- old\n+++ new\n"
+                   "@@ -1,3 +1,3 @@\n"
+                   " a\n-b\n+x\n c\n",
+                   diff("a\nb\nc\n", "a\nx\nc\n"));
+}
+
+ATF_TEST_CASE(unified_empty);
+ATF_TEST_CASE_HEAD(unified_empty)
+{
+    set_md_var("descr", "Tests the diff against an empty text");
+}
+ATF_TEST_CASE_BODY(unified_empty)
+{
+    ATF_REQUIRE_EQ("--- old\n+++ new\n"
+                   "@@ -0,0 +1,2 @@\n"
+                   "+foo\n+bar\n",
+                   diff("", "foo\nbar\n"));
+    ATF_REQUIRE_EQ("--- old\n+++ new\n"
+                   "@@ -1 +0,0 @@\n"
+                   "-foo\n",
+                   diff("foo\n", ""));
+}
+
+ATF_TEST_CASE(unified_no_newline);
+ATF_TEST_CASE_HEAD(unified_no_newline)
+{
+    set_md_var("descr", "Tests the diff of texts that do not end in a "
+               "newline");
+}
+ATF_TEST_CASE_BODY(unified_no_newline)
+{
+    ATF_REQUIRE_EQ("--- old\n+++ new\n"
+                   "@@ -1 +1 @@\n"
+                   "-foo\n"
+                   "\\ No newline at end of file\n"
+                   "+foo\n",
+                   diff("foo", "foo\n"));
+}
+
+ATF_TEST_CASE(unified_hunks);
+ATF_TEST_CASE_HEAD(unified_hunks)
+{
+    set_md_var("descr", "Tests that distant changes go to separate hunks "
+               "and close ones share a hunk");
+}
+ATF_TEST_CASE_BODY(unified_hunks)
+{
+    const std::string old_text = numbers(1, 20);
+
+    ATF_REQUIRE_EQ("--- old\n+++ new\n"
+                   "@@ -1,5 +1,5 @@\n"
+                   " 1\n-2\n+x\n 3\n 4\n 5\n"
+                   "@@ -7,7 +7,7 @@\n"
+                   " 7\n 8\n 9\n-10\n+y\n 11\n 12\n 13\n",
+                   diff(old_text, "1\nx\n" + numbers(3, 9) + "y\n" +
+                        numbers(11, 20)));
+
+    ATF_REQUIRE_EQ("--- old\n+++ new\n"
+                   "@@ -1,12 +1,12 @@\n"
+                   " 1\n-2\n+x\n 3\n 4\n 5\n 6\n 7\n 8\n-9\n+y\n"
+                   " 10\n 11\n 12\n",
+                   diff(old_text, "1\nx\n" + numbers(3, 8) + "y\n" +
+                        numbers(10, 20)));
+}
+
+ATF_TEST_CASE(unified_max_lines);
+ATF_TEST_CASE_HEAD(unified_max_lines)
+{
+    set_md_var("descr", "Tests that the output is truncated after the "
+               "given number of lines");
+}
+ATF_TEST_CASE_BODY(unified_max_lines)
+{
+    ATF_REQUIRE_EQ("--- old\n+++ new\n"
+                   "@@ -0,0 +1,10 @@\n"
+                   "+1\n+2\n+3\n"
+                   "[... differences truncated after 3 lines ...]\n",
+                   diff("", numbers(1, 10), 3));
+}
+
+ATF_TEST_CASE(unified_large);
+ATF_TEST_CASE_HEAD(unified_large)
+{
+    set_md_var("descr", "Tests the diff of texts that differ too much to "
+               "compute the shortest edit script");
+}
+ATF_TEST_CASE_BODY(unified_large)
+{
+    const std::string out = diff(numbers(1, 3000), numbers(5001, 8000),
+                                 10000);
+
+    std::istringstream is(out);
+    std::string line;
+    std::size_t deleted = 0, inserted = 0;
+    while (std::getline(is, line)) {
+        if (line.compare(0, 4, "--- ") == 0 || line.compare(0, 4, "+++ ") == 0)
+            continue;
+        if (line[0] == '-')
+            deleted++;
+        else if (line[0] == '+')
+            inserted++;
+    }
+    ATF_REQUIRE_EQ(3000, deleted);
+    ATF_REQUIRE_EQ(3000, inserted);
+}
+
+// ------------------------------------------------------------------------
+// Main.
+// ------------------------------------------------------------------------
+
+ATF_INIT_TEST_CASES(tcs)
+{
+    // Add the test cases for the free functions.
+    ATF_ADD_TEST_CASE(tcs, unified_equal);
+    ATF_ADD_TEST_CASE(tcs, unified_change);
+    ATF_ADD_TEST_CASE(tcs, unified_empty);
+    ATF_ADD_TEST_CASE(tcs, unified_no_newline);
+    ATF_ADD_TEST_CASE(tcs, unified_hunks);
+    ATF_ADD_TEST_CASE(tcs, unified_max_lines);
+    ATF_ADD_TEST_CASE(tcs, unified_large);
+}
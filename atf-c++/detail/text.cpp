@@ -31,6 +31,7 @@ extern "C" {
 
 #include <cctype>
 #include <cstring>
+#include <map>
 
 extern "C" {
 #include "atf-c/detail/text.h"
@@ -38,10 +39,195 @@ extern "C" {
 }
 
 #include "atf-c++/detail/exceptions.hpp"
+#include "atf-c++/detail/sanity.hpp"
 
 namespace impl = atf::text;
 #define IMPL_NAME "atf::text"
 
+// ------------------------------------------------------------------------
+// The "regex" class.
+// ------------------------------------------------------------------------
+
+namespace {
+
+// Skips over the bracket expression that starts at position i of re and
+// returns the position just past it, or std::string::npos if it does not
+// end.
+static
+std::string::size_type
+skip_bracket(const std::string& re, std::string::size_type i)
+{
+    PRE(re[i] == '[');
+    i++;
+    if (i < re.length() && re[i] == '^')
+        i++;
+    if (i < re.length() && re[i] == ']')
+        i++;
+
+    while (i < re.length() && re[i] != ']') {
+        if (re[i] == '[' && i + 1 < re.length() &&
+            std::strchr(":.=", re[i + 1]) != NULL) {
+            const char close[] = { re[i + 1], ']', '\0' };
+            i = re.find(close, i + 2);
+            if (i == std::string::npos)
+                return i;
+            i += 2;
+        } else
+            i++;
+    }
+
+    return i < re.length() ? i + 1 : std::string::npos;
+}
+
+// Computes the longest run of ordinary characters that any text matching
+// the extended regular expression re must contain.  This is conservative:
+// it gives up on alternations and ignores everything within groups.
+static
+std::string
+required_literal(const std::string& re)
+{
+    if (re.find('|') != std::string::npos)
+        return "";
+
+    std::string best, run;
+    int depth = 0;
+    std::string::size_type i = 0;
+    while (i < re.length()) {
+        const char c = re[i];
+
+        if (c == '*' || c == '?' || c == '{') {
+            // The previous character is optional or repeated an unknown
+            // number of times.
+            if (!run.empty())
+                run.erase(run.length() - 1);
+        }
+
+        if (c == '[') {
+            i = skip_bracket(re, i);
+            if (i == std::string::npos)
+                return "";
+        } else if (c == '{') {
+            i = re.find('}', i);
+            if (i == std::string::npos)
+                return "";
+            i++;
+        } else if (c == '\\') {
+            i += 2;
+        } else {
+            if (c == '(')
+                depth++;
+            else if (c == ')' && --depth < 0)
+                return "";
+            else if (depth == 0 && std::strchr(".^$*+?\n", c) == NULL) {
+                run += c;
+                i++;
+                continue;
+            }
+            i++;
+        }
+
+        if (run.length() > best.length())
+            best = run;
+        run.clear();
+    }
+    if (run.length() > best.length())
+        best = run;
+
+    return best;
+}
+
+} // anonymous namespace
+
+struct atf::text::regex_impl {
+    std::string m_str;
+    std::string m_literal;
+    bool m_compiled;
+    ::regex_t m_preg;
+
+    regex_impl(const std::string& str) :
+        m_str(str),
+        m_compiled(false)
+    {
+        // Special case: regcomp does not like empty regular expressions.
+        if (!m_str.empty()) {
+            if (::regcomp(&m_preg, m_str.c_str(), REG_EXTENDED) != 0)
+                throw std::runtime_error("Invalid regular expression '" +
+                                         m_str + "'");
+            m_compiled = true;
+            m_literal = required_literal(m_str);
+        }
+    }
+
+    ~regex_impl(void)
+    {
+        if (m_compiled)
+            ::regfree(&m_preg);
+    }
+};
+
+impl::regex::regex(const std::string& str) :
+    m_pimpl(new regex_impl(str))
+{
+}
+
+const std::string&
+impl::regex::str(void)
+    const
+{
+    return m_pimpl->m_str;
+}
+
+bool
+impl::regex::matches(const std::string& str)
+    const
+{
+    if (!m_pimpl->m_compiled)
+        return str.empty();
+
+    const int res = ::regexec(&m_pimpl->m_preg, str.c_str(), 0, NULL, 0);
+    if (res != 0 && res != REG_NOMATCH)
+        throw std::runtime_error("Invalid regular expression " +
+                                 m_pimpl->m_str);
+
+    return res == 0;
+}
+
+const std::string&
+impl::regex::literal(void)
+    const
+{
+    return m_pimpl->m_literal;
+}
+
+bool
+impl::regex::matches(const char* begin, const char* end)
+    const
+{
+    PRE(begin <= end);
+
+    if (!m_pimpl->m_compiled)
+        return begin == end;
+
+#if defined(REG_STARTEND)
+    ::regmatch_t pmatch;
+    pmatch.rm_so = 0;
+    pmatch.rm_eo = end - begin;
+    const int res = ::regexec(&m_pimpl->m_preg, begin, 1, &pmatch,
+                              REG_STARTEND);
+    if (res != 0 && res != REG_NOMATCH)
+        throw std::runtime_error("Invalid regular expression " +
+                                 m_pimpl->m_str);
+
+    return res == 0;
+#else
+    return matches(std::string(begin, end));
+#endif
+}
+
+// ------------------------------------------------------------------------
+// Free functions.
+// ------------------------------------------------------------------------
+
 char*
 impl::duplicate(const char* str)
 {
@@ -50,30 +236,35 @@ impl::duplicate(const char* str)
     return copy;
 }
 
-bool
-impl::match(const std::string& str, const std::string& regex)
-{
-    bool found;
+namespace {
 
-    // Special case: regcomp does not like empty regular expressions.
-    if (regex.empty()) {
-        found = str.empty();
-    } else {
-        ::regex_t preg;
+// Maximum number of compiled expressions kept by match().
+static const std::map< std::string, impl::regex >::size_type max_cached = 32;
 
-        if (::regcomp(&preg, regex.c_str(), REG_EXTENDED) != 0)
-            throw std::runtime_error("Invalid regular expression '" + regex +
-                                     "'");
+static
+impl::regex
+cached_regex(const std::string& str)
+{
+    static std::map< std::string, impl::regex > cache;
 
-        const int res = ::regexec(&preg, str.c_str(), 0, NULL, 0);
-        regfree(&preg);
-        if (res != 0 && res != REG_NOMATCH)
-            throw std::runtime_error("Invalid regular expression " + regex);
+    std::map< std::string, impl::regex >::const_iterator iter =
+        cache.find(str);
+    if (iter != cache.end())
+        return (*iter).second;
 
-        found = res == 0;
-    }
+    if (cache.size() >= max_cached)
+        cache.clear();
+    const impl::regex re(str);
+    cache.insert(std::make_pair(str, re));
+    return re;
+}
+
+} // anonymous namespace
 
-    return found;
+bool
+impl::match(const std::string& str, const std::string& regex)
+{
+    return cached_regex(regex).matches(str);
 }
 
 std::string
@@ -30,6 +30,7 @@ extern "C" {
 #include <stdint.h>
 }
 
+#include <memory>
 #include <sstream>
 #include <stdexcept>
 #include <string>
@@ -72,9 +73,39 @@ join(const T& words, const std::string& separator)
     return str;
 }
 
+struct regex_impl;
+
+//!
+//! \brief A compiled extended regular expression.
+//!
+//! Compiling a regular expression is much more expensive than matching it,
+//! so code that matches the same expression against many strings should
+//! construct one of these objects and reuse it.  Copies share the compiled
+//! expression.
+//!
+//! The literal() method returns a string that must appear in any text that
+//! matches the expression, or an empty string if there is no such string.
+//! Callers can look for it with a plain memory search to discard most of
+//! the text before resorting to the regular expression engine.
+//!
+class regex {
+    std::shared_ptr< regex_impl > m_pimpl;
+
+public:
+    explicit regex(const std::string&);
+
+    const std::string& str(void) const;
+    const std::string& literal(void) const;
+    bool matches(const std::string&) const;
+    bool matches(const char*, const char*) const;
+};
+
 //!
 //! \brief Checks if the string matches a regular expression.
 //!
+//! The most recently used expressions are kept compiled, so calling this
+//! repeatedly with the same expression does not recompile it every time.
+//!
 bool match(const std::string&, const std::string&);
 
 //!
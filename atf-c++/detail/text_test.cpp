@@ -27,6 +27,7 @@
 
 #include <cstring>
 #include <set>
+#include <sstream>
 #include <vector>
 
 #include <atf-c++.hpp>
@@ -155,6 +156,99 @@ ATF_TEST_CASE_BODY(match)
     ATF_REQUIRE(!match("hello", "^ [a-z]+$"));
 }
 
+ATF_TEST_CASE(match_many);
+ATF_TEST_CASE_HEAD(match_many)
+{
+    set_md_var("descr", "Tests the match function with more expressions "
+               "than it keeps compiled");
+}
+ATF_TEST_CASE_BODY(match_many)
+{
+    using atf::text::match;
+
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < 100; i++) {
+            std::ostringstream re;
+            re << "^" << i << "$";
+            std::ostringstream str;
+            str << i;
+
+            ATF_REQUIRE(match(str.str(), re.str()));
+            ATF_REQUIRE(!match(str.str() + "0", re.str()));
+        }
+    }
+}
+
+ATF_TEST_CASE(regex);
+ATF_TEST_CASE_HEAD(regex)
+{
+    set_md_var("descr", "Tests the regex class");
+}
+ATF_TEST_CASE_BODY(regex)
+{
+    using atf::text::regex;
+
+    ATF_REQUIRE_THROW(std::runtime_error, regex("["));
+
+    const regex empty("");
+    ATF_REQUIRE(empty.matches(""));
+    ATF_REQUIRE(!empty.matches("foo"));
+
+    const regex re("^[a-z]+$");
+    ATF_REQUIRE_EQ("^[a-z]+$", re.str());
+    ATF_REQUIRE(re.matches("hello"));
+    ATF_REQUIRE(!re.matches("hello5"));
+
+    const regex copy = re;
+    ATF_REQUIRE(copy.matches("world"));
+    ATF_REQUIRE(!copy.matches(""));
+}
+
+ATF_TEST_CASE(regex_buffer);
+ATF_TEST_CASE_HEAD(regex_buffer)
+{
+    set_md_var("descr", "Tests the regex class on buffers that are not "
+               "nul-terminated");
+}
+ATF_TEST_CASE_BODY(regex_buffer)
+{
+    using atf::text::regex;
+
+    const char* text = "foo bar\nbaz";
+
+    ATF_REQUIRE(regex("^foo bar$").matches(text, text + 7));
+    ATF_REQUIRE(!regex("^foo$").matches(text, text + 7));
+    ATF_REQUIRE(!regex("baz").matches(text, text + 7));
+    ATF_REQUIRE(regex("^baz$").matches(text + 8, text + 11));
+    ATF_REQUIRE(regex("").matches(text, text));
+    ATF_REQUIRE(!regex("").matches(text, text + 1));
+}
+
+ATF_TEST_CASE(regex_literal);
+ATF_TEST_CASE_HEAD(regex_literal)
+{
+    set_md_var("descr", "Tests the computation of the literal required by "
+               "a regular expression");
+}
+ATF_TEST_CASE_BODY(regex_literal)
+{
+    using atf::text::regex;
+
+    ATF_REQUIRE_EQ("", regex("").literal());
+    ATF_REQUIRE_EQ("foo", regex("foo").literal());
+    ATF_REQUIRE_EQ("foo", regex("^foo.*bar$").literal());
+    ATF_REQUIRE_EQ("barbaz", regex("^foo.*barbaz$").literal());
+    ATF_REQUIRE_EQ("", regex("foo|bar").literal());
+    ATF_REQUIRE_EQ("a", regex("ab*c").literal());
+    ATF_REQUIRE_EQ("ab", regex("ab+c").literal());
+    ATF_REQUIRE_EQ("xyz", regex("[[:alpha:]]+xyz").literal());
+    ATF_REQUIRE_EQ("x", regex("[]x]x").literal());
+    ATF_REQUIRE_EQ("bar", regex("(foo)?bar").literal());
+    ATF_REQUIRE_EQ("yy", regex("x{2}yy").literal());
+    ATF_REQUIRE_EQ("foo", regex("a\\.foo").literal());
+    ATF_REQUIRE_EQ("", regex(".*").literal());
+}
+
 ATF_TEST_CASE(split);
 ATF_TEST_CASE_HEAD(split)
 {
@@ -376,6 +470,10 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, duplicate);
     ATF_ADD_TEST_CASE(tcs, join);
     ATF_ADD_TEST_CASE(tcs, match);
+    ATF_ADD_TEST_CASE(tcs, match_many);
+    ATF_ADD_TEST_CASE(tcs, regex);
+    ATF_ADD_TEST_CASE(tcs, regex_buffer);
+    ATF_ADD_TEST_CASE(tcs, regex_literal);
     ATF_ADD_TEST_CASE(tcs, split);
     ATF_ADD_TEST_CASE(tcs, split_delims);
     ATF_ADD_TEST_CASE(tcs, trim);
@@ -72,6 +72,29 @@
     atfu_tc_ ## name::atfu_tc_ ## name(void) : atf::tests::tc(#name, true) {} \
     }
 
+#define ATF_BENCH_WITHOUT_HEAD(name) \
+    namespace { \
+    class atfu_tc_ ## name : public atf::tests::bench_tc { \
+        void bench_body(const size_t) const; \
+    public: \
+        atfu_tc_ ## name(void); \
+    }; \
+    static atfu_tc_ ## name* atfu_tcptr_ ## name; \
+    atfu_tc_ ## name::atfu_tc_ ## name(void) : atf::tests::bench_tc(#name) {} \
+    }
+
+#define ATF_BENCH(name) \
+    namespace { \
+    class atfu_tc_ ## name : public atf::tests::bench_tc { \
+        void bench_head(void); \
+        void bench_body(const size_t) const; \
+    public: \
+        atfu_tc_ ## name(void); \
+    }; \
+    static atfu_tc_ ## name* atfu_tcptr_ ## name; \
+    atfu_tc_ ## name::atfu_tc_ ## name(void) : atf::tests::bench_tc(#name) {} \
+    }
+
 #define ATF_TEST_CASE_NAME(name) atfu_tc_ ## name
 #define ATF_TEST_CASE_USE(name) (atfu_tcptr_ ## name) = NULL
 
@@ -89,6 +112,15 @@
     atfu_tc_ ## name::cleanup(void) \
         const
 
+#define ATF_BENCH_HEAD(name) \
+    void \
+    atfu_tc_ ## name::bench_head(void)
+
+#define ATF_BENCH_BODY(name, iterations) \
+    void \
+    atfu_tc_ ## name::bench_body(const size_t iterations) \
+        const
+
 #define ATF_FAIL(reason) atf::tests::tc::fail(reason)
 
 #define ATF_SKIP(reason) atf::tests::tc::skip(reason)
@@ -52,6 +52,9 @@ extern "C" {
 #include <vector>
 
 extern "C" {
+#include "atf-c/detail/dynstr.h"
+#include "atf-c/detail/listing.h"
+#include "atf-c/detail/usage.h"
 #include "atf-c/error.h"
 #include "atf-c/tc.h"
 #include "atf-c/utils.h"
@@ -161,6 +164,12 @@ public:
     {
     }
 
+    static const std::string&
+    ident(const impl::tc* tc)
+    {
+        return tc->pimpl->m_ident;
+    }
+
     static void
     wrap_head(atf_tc_t *tc)
     {
@@ -186,6 +195,22 @@ public:
         INV(iter != cwraps.end());
         (*iter).second->cleanup();
     }
+
+    static void
+    wrap_bench(const atf_tc_t *tc, const size_t iterations)
+    {
+        std::map< const atf_tc_t*, const impl::tc* >::const_iterator iter =
+            cwraps.find(tc);
+        INV(iter != cwraps.end());
+        static_cast< const impl::bench_tc* >((*iter).second)->bench_body(
+            iterations);
+    }
+
+    static void
+    run_bench(const impl::bench_tc* tc)
+    {
+        atf_tc_bench(&tc->pimpl->m_tc, wrap_bench);
+    }
 };
 
 impl::tc::tc(const std::string& ident, const bool has_cleanup) :
@@ -399,6 +424,38 @@ impl::tc::expect_timeout(const std::string& reason)
     atf_tc_expect_timeout("%s", reason.c_str());
 }
 
+// ------------------------------------------------------------------------
+// The "bench_tc" class.
+// ------------------------------------------------------------------------
+
+impl::bench_tc::bench_tc(const std::string& ident) :
+    tc(ident, false)
+{
+}
+
+impl::bench_tc::~bench_tc(void)
+{
+}
+
+void
+impl::bench_tc::head(void)
+{
+    set_md_var("X-bench", "true");
+    bench_head();
+}
+
+void
+impl::bench_tc::body(void)
+    const
+{
+    tc_impl::run_bench(this);
+}
+
+void
+impl::bench_tc::bench_head(void)
+{
+}
+
 // ------------------------------------------------------------------------
 // Test program main code.
 // ------------------------------------------------------------------------
@@ -461,10 +518,68 @@ init_tcs(void (*add_tcs)(tc_vector&), tc_vector& tcs,
     }
 }
 
-static int
-list_tcs(const tc_vector& tcs)
+static void
+warn_atf_error(atf_error_t err)
 {
-    detail::atf_tp_writer writer(std::cout);
+    char buf[4096];
+
+    atf_error_format(err, buf, sizeof(buf));
+    atf_error_free(err);
+    std::cerr << Program_Name << ": WARNING: " << buf << '\n';
+}
+
+static std::string
+listing_cache_key(const atf::fs::path& exe, const atf::tests::vars_map& vars)
+{
+    std::vector< const char * > array;
+    array.reserve((vars.size() * 2) + 1);
+    for (atf::tests::vars_map::const_iterator iter = vars.begin();
+         iter != vars.end(); iter++) {
+        array.push_back((*iter).first.c_str());
+        array.push_back((*iter).second.c_str());
+    }
+    array.push_back(nullptr);
+
+    atf_dynstr_t key;
+    atf_error_t err = atf_listing_cache_key(exe.c_path(), array.data(), &key);
+    if (atf_is_error(err)) {
+        warn_atf_error(err);
+        return "";
+    }
+    const std::string str = atf_dynstr_cstring(&key);
+    atf_dynstr_fini(&key);
+    return str;
+}
+
+// Looks for a listing of the test program cached by a previous run.
+// Problems with the cache are reported and cause the listing to be
+// recomputed.
+static bool
+find_listing(const std::string& cache, const std::string& key,
+             std::string& listing)
+{
+    atf_dynstr_t str;
+    bool found = false;
+
+    if (!key.empty()) {
+        atf_error_t err = atf_listing_read_cache(cache.c_str(), key.c_str(),
+                                                 &str, &found);
+        if (atf_is_error(err))
+            warn_atf_error(err);
+    }
+
+    if (found) {
+        listing = atf_dynstr_cstring(&str);
+        atf_dynstr_fini(&str);
+    }
+    return found;
+}
+
+static std::string
+format_tcs(const tc_vector& tcs)
+{
+    std::ostringstream listing;
+    detail::atf_tp_writer writer(listing);
 
     for (tc_vector::const_iterator iter = tcs.begin();
          iter != tcs.end(); iter++) {
@@ -486,6 +601,32 @@ list_tcs(const tc_vector& tcs)
         writer.end_tc();
     }
 
+    return listing.str();
+}
+
+static int
+list_tcs(void (*add_tcs)(tc_vector&), tc_vector& tcs,
+         const atf::tests::vars_map& vars, const std::string& cache)
+{
+    const atf::fs::path exe = atf::fs::path(vars.find("srcdir")->second) /
+        Program_Name;
+
+    const std::string key = cache.empty() ? "" : listing_cache_key(exe, vars);
+
+    std::string listing;
+    if (!find_listing(cache, key, listing)) {
+        init_tcs(add_tcs, tcs, vars);
+        listing = format_tcs(tcs);
+
+        if (!key.empty()) {
+            atf_error_t err = atf_listing_write_cache(cache.c_str(),
+                key.c_str(), listing.c_str());
+            if (atf_is_error(err))
+                warn_atf_error(err);
+        }
+    }
+
+    std::cout << listing;
     return EXIT_SUCCESS;
 }
 
@@ -497,7 +638,9 @@ find_tc(tc_vector tcs, const std::string& name)
          iter != tcs.end(); iter++) {
         impl::tc* tc = *iter;
 
-        if (tc->get_md_var("ident") == name)
+        // Do not query the metadata, which would evaluate the heads of
+        // all the test cases preceding the one being looked for.
+        if (impl::tc_impl::ident(tc) == name)
             return tc;
     }
     throw usage_error("Unknown test case `%s'", name.c_str());
@@ -545,7 +688,18 @@ run_tc(tc_vector& tcs, const std::string& tcarg, const atf::fs::path& resfile)
         tc->run(resfile.str());
         break;
     case CLEANUP:
-        tc->run_cleanup();
+        if (atf::text::to_bool(tc->get_config_var(ATF_USAGE_CONFIG_VAR,
+                                                  "false"))) {
+            atf_usage_t usage;
+
+            atf_usage_start(&usage);
+            tc->run_cleanup();
+            atf_error_t err = atf_usage_append(&usage, "cleanup",
+                                               resfile.c_str());
+            if (atf_is_error(err))
+                atf::throw_atf_error(err);
+        } else
+            tc->run_cleanup();
         break;
     default:
         UNREACHABLE;
@@ -559,6 +713,7 @@ safe_main(int argc, char** argv, void (*add_tcs)(tc_vector&))
     const char* argv0 = argv[0];
 
     bool lflag = false;
+    std::string cache;
     atf::fs::path resfile("/dev/stdout");
     std::string srcdir_arg;
     atf::tests::vars_map vars;
@@ -568,8 +723,12 @@ safe_main(int argc, char** argv, void (*add_tcs)(tc_vector&))
 
     old_opterr = opterr;
     ::opterr = 0;
-    while ((ch = ::getopt(argc, argv, GETOPT_POSIX ":lr:s:v:")) != -1) {
+    while ((ch = ::getopt(argc, argv, GETOPT_POSIX ":C:lr:s:v:")) != -1) {
         switch (ch) {
+        case 'C':
+            cache = ::optarg;
+            break;
+
         case 'l':
             lflag = true;
             break;
@@ -614,9 +773,10 @@ safe_main(int argc, char** argv, void (*add_tcs)(tc_vector&))
         if (argc > 0)
             throw usage_error("Cannot provide test case names with -l");
 
-        init_tcs(add_tcs, tcs, vars);
-        errcode = list_tcs(tcs);
+        errcode = list_tcs(add_tcs, tcs, vars, cache);
     } else {
+        if (!cache.empty())
+            throw usage_error("-C can only be used together with -l");
         if (argc == 0)
             throw usage_error("Must provide a test case name");
         else if (argc > 1)
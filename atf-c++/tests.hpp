@@ -119,6 +119,25 @@ public:
     static void expect_timeout(const std::string&);
 };
 
+// ------------------------------------------------------------------------
+// The "bench_tc" class.
+// ------------------------------------------------------------------------
+
+class bench_tc : public tc {
+    void head(void);
+    void body(void) const;
+
+protected:
+    virtual void bench_head(void);
+    virtual void bench_body(const size_t) const = 0;
+
+    friend struct tc_impl;
+
+public:
+    bench_tc(const std::string&);
+    virtual ~bench_tc(void);
+};
+
 } // namespace tests
 } // namespace atf
 
@@ -0,0 +1,94 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#include "atf-c/detail/config_map.h"
+
+#include <stdlib.h>
+
+#include "atf-c/detail/sanity.h"
+#include "atf-c/error.h"
+
+struct atf_config_map {
+    atf_map_t m_map;
+    size_t m_refcount;
+};
+
+/* ---------------------------------------------------------------------
+ * The "atf_config_map" type.
+ * --------------------------------------------------------------------- */
+
+/*
+ * Constructors/destructors.
+ */
+
+atf_error_t
+atf_config_map_new(atf_config_map_t **cmp, const char *const *config)
+{
+    atf_config_map_t *cm;
+    atf_error_t err;
+
+    cm = malloc(sizeof(*cm));
+    if (cm == NULL)
+        return atf_no_memory_error();
+
+    err = atf_map_init_charpp(&cm->m_map, config);
+    if (atf_is_error(err)) {
+        free(cm);
+        return err;
+    }
+    cm->m_refcount = 1;
+
+    *cmp = cm;
+    return err;
+}
+
+atf_config_map_t *
+atf_config_map_ref(atf_config_map_t *cm)
+{
+    PRE(cm->m_refcount > 0);
+    cm->m_refcount++;
+    return cm;
+}
+
+void
+atf_config_map_unref(atf_config_map_t *cm)
+{
+    PRE(cm->m_refcount > 0);
+    cm->m_refcount--;
+    if (cm->m_refcount == 0) {
+        atf_map_fini(&cm->m_map);
+        free(cm);
+    }
+}
+
+/*
+ * Getters.
+ */
+
+const atf_map_t *
+atf_config_map_get(const atf_config_map_t *cm)
+{
+    return &cm->m_map;
+}
@@ -0,0 +1,52 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#if !defined(ATF_C_DETAIL_CONFIG_MAP_H)
+#define ATF_C_DETAIL_CONFIG_MAP_H
+
+#include <atf-c/detail/map.h>
+#include <atf-c/error_fwd.h>
+
+/* ---------------------------------------------------------------------
+ * The "atf_config_map" type.
+ * --------------------------------------------------------------------- */
+
+/* An immutable, reference-counted set of configuration variables.
+ *
+ * A test program parses its configuration once and all of its test cases
+ * hold a reference to the same object, so the cost of the configuration
+ * does not grow with the number of test cases. */
+struct atf_config_map;
+typedef struct atf_config_map atf_config_map_t;
+
+/* Constructors/destructors. */
+atf_error_t atf_config_map_new(atf_config_map_t **, const char *const *);
+atf_config_map_t *atf_config_map_ref(atf_config_map_t *);
+void atf_config_map_unref(atf_config_map_t *);
+
+/* Getters. */
+const atf_map_t *atf_config_map_get(const atf_config_map_t *);
+
+#endif /* !defined(ATF_C_DETAIL_CONFIG_MAP_H) */
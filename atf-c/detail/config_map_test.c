@@ -0,0 +1,137 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#include "atf-c/detail/config_map.h"
+
+#include <string.h>
+
+#include <atf-c.h>
+
+#include "atf-c/detail/map.h"
+#include "atf-c/detail/tc.h"
+#include "atf-c/detail/test_helpers.h"
+
+/* ---------------------------------------------------------------------
+ * Tests for the "atf_config_map" type.
+ * --------------------------------------------------------------------- */
+
+ATF_TC(new);
+ATF_TC_HEAD(new, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks the atf_config_map_new function");
+}
+ATF_TC_BODY(new, tc)
+{
+    atf_config_map_t *cm;
+    const atf_map_t *map;
+    const char *const array[] = { "K1", "V1", "K2", "V2", NULL };
+
+    RE(atf_config_map_new(&cm, NULL));
+    ATF_REQUIRE_EQ(atf_map_size(atf_config_map_get(cm)), 0);
+    atf_config_map_unref(cm);
+
+    RE(atf_config_map_new(&cm, array));
+    map = atf_config_map_get(cm);
+    ATF_REQUIRE_EQ(atf_map_size(map), 2);
+    ATF_REQUIRE(strcmp(atf_map_citer_data(atf_map_find_c(map, "K1")),
+                       "V1") == 0);
+    ATF_REQUIRE(strcmp(atf_map_citer_data(atf_map_find_c(map, "K2")),
+                       "V2") == 0);
+    atf_config_map_unref(cm);
+}
+
+ATF_TC(new_short);
+ATF_TC_HEAD(new_short, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that atf_config_map_new reports "
+                      "a key without a value");
+}
+ATF_TC_BODY(new_short, tc)
+{
+    atf_config_map_t *cm;
+    const char *const array[] = { "K1", "V1", "K2", NULL };
+
+    atf_error_t err = atf_config_map_new(&cm, array);
+    ATF_REQUIRE(atf_is_error(err));
+    atf_error_free(err);
+}
+
+ATF_TC(refcount);
+ATF_TC_HEAD(refcount, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that the configuration outlives "
+                      "all but its last reference");
+}
+ATF_TC_BODY(refcount, tc)
+{
+    atf_config_map_t *cm, *cm2;
+    const char *const array[] = { "K1", "V1", NULL };
+
+    RE(atf_config_map_new(&cm, array));
+    cm2 = atf_config_map_ref(cm);
+    ATF_REQUIRE_EQ(cm, cm2);
+
+    atf_config_map_unref(cm);
+    ATF_REQUIRE(strcmp(atf_map_citer_data(atf_map_find_c(
+        atf_config_map_get(cm2), "K1")), "V1") == 0);
+    atf_config_map_unref(cm2);
+}
+
+ATF_TC(shared_by_tcs);
+ATF_TC_HEAD(shared_by_tcs, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that test cases initialized with "
+                      "atf_tc_init_pack_config share the configuration");
+}
+ATF_TC_BODY(shared_by_tcs, tc)
+{
+    atf_config_map_t *cm;
+    atf_tc_t tc1, tc2;
+    const char *const array[] = { "K1", "V1", NULL };
+
+    RE(atf_config_map_new(&cm, array));
+    RE(atf_tc_init_pack_config(&tc1, &ATF_TC_PACK_NAME(new), cm));
+    RE(atf_tc_init_pack_config(&tc2, &ATF_TC_PACK_NAME(refcount), cm));
+    atf_config_map_unref(cm);
+
+    ATF_REQUIRE_STREQ("V1", atf_tc_get_config_var(&tc1, "K1"));
+    atf_tc_fini(&tc1);
+    ATF_REQUIRE_STREQ("V1", atf_tc_get_config_var(&tc2, "K1"));
+    atf_tc_fini(&tc2);
+}
+
+/* ---------------------------------------------------------------------
+ * Main.
+ * --------------------------------------------------------------------- */
+
+ATF_TP_ADD_TCS(tp)
+{
+    ATF_TP_ADD_TC(tp, new);
+    ATF_TP_ADD_TC(tp, new_short);
+    ATF_TP_ADD_TC(tp, refcount);
+    ATF_TP_ADD_TC(tp, shared_by_tcs);
+
+    return atf_no_error();
+}
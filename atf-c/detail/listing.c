@@ -0,0 +1,242 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#include "atf-c/detail/listing.h"
+
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "atf-c/detail/sanity.h"
+#include "atf-c/error.h"
+
+/* Identifies the format of the cache files.  Must be changed whenever the
+ * format of the key changes so that old caches are ignored. */
+#define CACHE_MAGIC "atf-tp-listing-cache-2"
+
+/* ---------------------------------------------------------------------
+ * Auxiliary functions.
+ * --------------------------------------------------------------------- */
+
+static
+unsigned int
+hash_config(const char *const *config)
+{
+    /* FNV-1a over the keys and values, including their terminators. */
+    uint32_t h = 2166136261u;
+    const char *const *ptr;
+
+    for (ptr = config; *ptr != NULL; ptr++) {
+        const char *ch = *ptr;
+        do {
+            h ^= (unsigned char)*ch;
+            h *= 16777619u;
+        } while (*ch++ != '\0');
+    }
+    return h;
+}
+
+static
+atf_error_t
+read_all(const int fd, const char *path, atf_dynstr_t *str)
+{
+    atf_error_t err;
+    char buf[4096];
+    ssize_t cnt;
+
+    err = atf_no_error();
+    while (!atf_is_error(err) && (cnt = read(fd, buf, sizeof(buf))) != 0) {
+        if (cnt == -1) {
+            if (errno != EINTR)
+                err = atf_libc_error(errno, "Failed to read %s", path);
+        } else
+            err = atf_dynstr_append_fmt(str, "%.*s", (int)cnt, buf);
+    }
+    return err;
+}
+
+static
+atf_error_t
+write_all(const int fd, const char *path, const char *data, size_t length)
+{
+    while (length > 0) {
+        const ssize_t cnt = write(fd, data, length);
+        if (cnt == -1) {
+            if (errno != EINTR)
+                return atf_libc_error(errno, "Failed to write %s", path);
+        } else {
+            data += cnt;
+            length -= cnt;
+        }
+    }
+    return atf_no_error();
+}
+
+/* ---------------------------------------------------------------------
+ * Free functions.
+ * --------------------------------------------------------------------- */
+
+/** Returns the sub-second part of the modification time of a file.
+ *
+ * Without it, rebuilding a test program within the same second it was last
+ * listed might keep its size and go unnoticed. */
+static
+long
+mtime_nsec(const struct stat *sb)
+{
+#if defined(HAVE_STRUCT_STAT_ST_MTIM)
+    return sb->st_mtim.tv_nsec;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+    return sb->st_mtimespec.tv_nsec;
+#else
+    return 0;
+#endif
+}
+
+/** Computes the key that identifies a cached listing.
+ *
+ * The key changes whenever the test program is replaced, as detected by
+ * its device, inode, modification time and size, or whenever it is given
+ * a different configuration. */
+atf_error_t
+atf_listing_cache_key(const atf_fs_path_t *exe, const char *const *config,
+                      atf_dynstr_t *key)
+{
+    struct stat sb;
+
+    if (stat(atf_fs_path_cstring(exe), &sb) == -1)
+        return atf_libc_error(errno, "Cannot get information of %s",
+                              atf_fs_path_cstring(exe));
+
+    return atf_dynstr_init_fmt(key, CACHE_MAGIC " %ju %ju %jd.%09ld %jd %08x",
+                               (uintmax_t)sb.st_dev, (uintmax_t)sb.st_ino,
+                               (intmax_t)sb.st_mtime, mtime_nsec(&sb),
+                               (intmax_t)sb.st_size, hash_config(config));
+}
+
+/** Reads a cached listing.
+ *
+ * found is set to true, and listing is initialized, only if the cache
+ * file exists and was created for the given key. */
+atf_error_t
+atf_listing_read_cache(const char *path, const char *key,
+                       atf_dynstr_t *listing, bool *found)
+{
+    atf_error_t err;
+    atf_dynstr_t contents;
+    const char *data, *nl;
+    int fd;
+
+    *found = false;
+
+    fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        if (errno == ENOENT)
+            return atf_no_error();
+        return atf_libc_error(errno, "Cannot open %s", path);
+    }
+
+    err = atf_dynstr_init(&contents);
+    if (atf_is_error(err))
+        goto out_fd;
+
+    err = read_all(fd, path, &contents);
+    if (atf_is_error(err))
+        goto out_contents;
+
+    data = atf_dynstr_cstring(&contents);
+    nl = strchr(data, '\n');
+    if (nl != NULL && (size_t)(nl - data) == strlen(key) &&
+        strncmp(data, key, nl - data) == 0) {
+        err = atf_dynstr_init_fmt(listing, "%s", nl + 1);
+        *found = !atf_is_error(err);
+    }
+
+out_contents:
+    atf_dynstr_fini(&contents);
+out_fd:
+    close(fd);
+    return err;
+}
+
+/** Stores a listing in a cache file under the given key.
+ *
+ * The file is replaced atomically so that concurrent readers never see
+ * a partially-written cache. */
+atf_error_t
+atf_listing_write_cache(const char *path, const char *key,
+                        const char *listing)
+{
+    atf_error_t err;
+    atf_dynstr_t contents, tmp;
+    int fd;
+
+    err = atf_dynstr_init_fmt(&tmp, "%s.%d", path, (int)getpid());
+    if (atf_is_error(err))
+        goto out;
+
+    err = atf_dynstr_init_fmt(&contents, "%s\n%s", key, listing);
+    if (atf_is_error(err))
+        goto out_tmp;
+
+    fd = open(atf_dynstr_cstring(&tmp), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        err = atf_libc_error(errno, "Cannot create %s",
+                             atf_dynstr_cstring(&tmp));
+        goto out_contents;
+    }
+
+    err = write_all(fd, atf_dynstr_cstring(&tmp),
+                    atf_dynstr_cstring(&contents),
+                    atf_dynstr_length(&contents));
+    if (close(fd) == -1 && !atf_is_error(err))
+        err = atf_libc_error(errno, "Failed to write %s",
+                             atf_dynstr_cstring(&tmp));
+
+    if (!atf_is_error(err) &&
+        rename(atf_dynstr_cstring(&tmp), path) == -1)
+        err = atf_libc_error(errno, "Cannot replace %s", path);
+
+    if (atf_is_error(err))
+        unlink(atf_dynstr_cstring(&tmp));
+
+out_contents:
+    atf_dynstr_fini(&contents);
+out_tmp:
+    atf_dynstr_fini(&tmp);
+out:
+    return err;
+}
@@ -0,0 +1,201 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#include "atf-c/detail/listing.h"
+
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <atf-c.h>
+
+#include "atf-c/detail/test_helpers.h"
+#include "atf-c/utils.h"
+
+/* ---------------------------------------------------------------------
+ * Test cases for the cache.
+ * --------------------------------------------------------------------- */
+
+ATF_TC_WITHOUT_HEAD(cache_key);
+ATF_TC_BODY(cache_key, tc)
+{
+    const char *const config1[] = { "a", "b", NULL };
+    const char *const config2[] = { "a", "c", NULL };
+    atf_fs_path_t exe;
+    atf_dynstr_t key1, key2, key3;
+
+    atf_utils_create_file("exe", "contents");
+    RE(atf_fs_path_init_fmt(&exe, "exe"));
+
+    RE(atf_listing_cache_key(&exe, config1, &key1));
+    RE(atf_listing_cache_key(&exe, config1, &key2));
+    ATF_REQUIRE(atf_equal_dynstr_dynstr(&key1, &key2));
+    atf_dynstr_fini(&key2);
+
+    RE(atf_listing_cache_key(&exe, config2, &key2));
+    ATF_REQUIRE(!atf_equal_dynstr_dynstr(&key1, &key2));
+
+    atf_utils_create_file("exe", "longer contents");
+    RE(atf_listing_cache_key(&exe, config1, &key3));
+    ATF_REQUIRE(!atf_equal_dynstr_dynstr(&key1, &key3));
+
+    atf_dynstr_fini(&key3);
+    atf_dynstr_fini(&key2);
+    atf_dynstr_fini(&key1);
+    atf_fs_path_fini(&exe);
+}
+
+ATF_TC(cache_key_subsecond);
+ATF_TC_HEAD(cache_key_subsecond, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that the key changes when the "
+                      "test program is modified within the same second");
+}
+ATF_TC_BODY(cache_key_subsecond, tc)
+{
+#if defined(HAVE_STRUCT_STAT_ST_MTIM) || defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+    const char *const config[] = { NULL };
+    struct timespec times[2];
+    atf_fs_path_t exe;
+    atf_dynstr_t key1, key2;
+
+    atf_utils_create_file("exe", "contents");
+    RE(atf_fs_path_init_fmt(&exe, "exe"));
+
+    times[0].tv_sec = times[1].tv_sec = 1000000000;
+    times[0].tv_nsec = times[1].tv_nsec = 100000000;
+    ATF_REQUIRE(utimensat(AT_FDCWD, "exe", times, 0) != -1);
+    RE(atf_listing_cache_key(&exe, config, &key1));
+
+    times[0].tv_nsec = times[1].tv_nsec = 200000000;
+    ATF_REQUIRE(utimensat(AT_FDCWD, "exe", times, 0) != -1);
+    RE(atf_listing_cache_key(&exe, config, &key2));
+    ATF_REQUIRE(!atf_equal_dynstr_dynstr(&key1, &key2));
+
+    atf_dynstr_fini(&key2);
+    atf_dynstr_fini(&key1);
+    atf_fs_path_fini(&exe);
+#else
+    atf_tc_skip("Modification times have a resolution of one second");
+#endif
+}
+
+ATF_TC_WITHOUT_HEAD(cache_key_missing);
+ATF_TC_BODY(cache_key_missing, tc)
+{
+    const char *const config[] = { NULL };
+    atf_fs_path_t exe;
+    atf_dynstr_t key;
+    atf_error_t err;
+
+    RE(atf_fs_path_init_fmt(&exe, "missing"));
+    err = atf_listing_cache_key(&exe, config, &key);
+    ATF_REQUIRE(atf_is_error(err));
+    ATF_REQUIRE(atf_error_is(err, "libc"));
+    atf_error_free(err);
+    atf_fs_path_fini(&exe);
+}
+
+ATF_TC_WITHOUT_HEAD(cache_roundtrip);
+ATF_TC_BODY(cache_roundtrip, tc)
+{
+    atf_dynstr_t listing;
+    bool found;
+
+    RE(atf_listing_read_cache("cache", "key1", &listing, &found));
+    ATF_REQUIRE(!found);
+
+    RE(atf_listing_write_cache("cache", "key1", "line 1\nline 2\n"));
+    ATF_REQUIRE(atf_utils_compare_file("cache", "key1\nline 1\nline 2\n"));
+
+    RE(atf_listing_read_cache("cache", "key1", &listing, &found));
+    ATF_REQUIRE(found);
+    ATF_REQUIRE_STREQ("line 1\nline 2\n", atf_dynstr_cstring(&listing));
+    atf_dynstr_fini(&listing);
+
+    RE(atf_listing_read_cache("cache", "key", &listing, &found));
+    ATF_REQUIRE(!found);
+    RE(atf_listing_read_cache("cache", "key12", &listing, &found));
+    ATF_REQUIRE(!found);
+
+    RE(atf_listing_write_cache("cache", "key2", "other\n"));
+    RE(atf_listing_read_cache("cache", "key1", &listing, &found));
+    ATF_REQUIRE(!found);
+    RE(atf_listing_read_cache("cache", "key2", &listing, &found));
+    ATF_REQUIRE(found);
+    ATF_REQUIRE_STREQ("other\n", atf_dynstr_cstring(&listing));
+    atf_dynstr_fini(&listing);
+}
+
+ATF_TC_WITHOUT_HEAD(cache_truncated);
+ATF_TC_BODY(cache_truncated, tc)
+{
+    atf_dynstr_t listing;
+    bool found;
+
+    atf_utils_create_file("cache", "key1");
+    RE(atf_listing_read_cache("cache", "key1", &listing, &found));
+    ATF_REQUIRE(!found);
+}
+
+ATF_TC(write_cache_error);
+ATF_TC_HEAD(write_cache_error, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that failing to create a cache "
+                      "is reported and leaves no temporary files behind");
+}
+ATF_TC_BODY(write_cache_error, tc)
+{
+    atf_error_t err;
+
+    err = atf_listing_write_cache("missing/cache", "key", "listing\n");
+    ATF_REQUIRE(atf_is_error(err));
+    ATF_REQUIRE(atf_error_is(err, "libc"));
+    atf_error_free(err);
+}
+
+/* ---------------------------------------------------------------------
+ * Main.
+ * --------------------------------------------------------------------- */
+
+ATF_TP_ADD_TCS(tp)
+{
+    ATF_TP_ADD_TC(tp, cache_key);
+    ATF_TP_ADD_TC(tp, cache_key_subsecond);
+    ATF_TP_ADD_TC(tp, cache_key_missing);
+    ATF_TP_ADD_TC(tp, cache_roundtrip);
+    ATF_TP_ADD_TC(tp, cache_truncated);
+    ATF_TP_ADD_TC(tp, write_cache_error);
+
+    return atf_no_error();
+}
@@ -26,6 +26,7 @@
 #include "atf-c/detail/map.h"
 
 #include <errno.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -37,31 +38,164 @@
  * Auxiliary functions.
  * --------------------------------------------------------------------- */
 
-struct map_entry {
-    char *m_key;
+/* Keys shorter than this are stored within the entry itself. */
+#define INLINE_KEY_SIZE 24
+
+/* Minimum size of the blocks of the arena. */
+#define CHUNK_SIZE 4096
+
+/* Lowest load factor of the index is 1/INDEX_LOAD_INV. */
+#define INDEX_LOAD_INV 2
+#define INDEX_INITIAL_SIZE 16
+
+struct atf_map_entry {
+    union {
+        char m_inline[INLINE_KEY_SIZE];
+        const char *m_ptr;
+    } m_key;
+    size_t m_keylen;
+    size_t m_hash;
+
     void *m_value;
     bool m_managed;
 };
 
+struct atf_map_chunk {
+    struct atf_map_chunk *m_next;
+    size_t m_used;
+    size_t m_size;
+    char m_data[];
+};
+
+static
+size_t
+hash_key(const char *key, const size_t len)
+{
+    /* FNV-1a. */
+    uint32_t h = 2166136261u;
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        h ^= (unsigned char)key[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
 static
-struct map_entry *
-new_entry(const char *key, void *value, bool managed)
+const char *
+entry_key(const struct atf_map_entry *me)
 {
-    struct map_entry *me;
-
-    me = (struct map_entry *)malloc(sizeof(*me));
-    if (me != NULL) {
-        me->m_key = strdup(key);
-        if (me->m_key == NULL) {
-            free(me);
-            me = NULL;
-        } else {
-            me->m_value = value;
-            me->m_managed = managed;
+    return me->m_keylen < INLINE_KEY_SIZE ? me->m_key.m_inline :
+        me->m_key.m_ptr;
+}
+
+/** Copies a string into the arena of the map.
+ *
+ * The copy remains valid until the map is finalized. */
+static
+char *
+arena_strdup(atf_map_t *m, const char *str, const size_t len)
+{
+    struct atf_map_chunk *chunk = m->m_arena;
+    char *copy;
+
+    if (chunk == NULL || chunk->m_size - chunk->m_used < len + 1) {
+        const size_t size = len + 1 > CHUNK_SIZE ? len + 1 : CHUNK_SIZE;
+
+        chunk = malloc(sizeof(*chunk) + size);
+        if (chunk == NULL)
+            return NULL;
+        chunk->m_used = 0;
+        chunk->m_size = size;
+        chunk->m_next = m->m_arena;
+        m->m_arena = chunk;
+    }
+
+    copy = chunk->m_data + chunk->m_used;
+    memcpy(copy, str, len + 1);
+    chunk->m_used += len + 1;
+    return copy;
+}
+
+/** Returns the slot of the index that holds, or would hold, key. */
+static
+size_t
+index_slot(const struct atf_map_entry *entries, const size_t *index,
+           const size_t index_size, const char *key, const size_t len,
+           const size_t hash)
+{
+    size_t i;
+
+    PRE(index_size > 0);
+
+    i = hash & (index_size - 1);
+    while (index[i] != 0) {
+        const struct atf_map_entry *me = &entries[index[i] - 1];
+
+        if (me->m_hash == hash && me->m_keylen == len &&
+            memcmp(entry_key(me), key, len) == 0)
+            break;
+        i = (i + 1) & (index_size - 1);
+    }
+    return i;
+}
+
+/** Returns the position of key in the entries or m_size if not found. */
+static
+size_t
+find_pos(const atf_map_t *m, const char *key)
+{
+    size_t len, slot;
+
+    if (m->m_index_size == 0)
+        return m->m_size;
+
+    len = strlen(key);
+    slot = index_slot(m->m_entries, m->m_index, m->m_index_size, key, len,
+                      hash_key(key, len));
+    return m->m_index[slot] == 0 ? m->m_size : m->m_index[slot] - 1;
+}
+
+/** Ensures that there is room for one more entry. */
+static
+atf_error_t
+reserve(atf_map_t *m)
+{
+    if (m->m_size == m->m_capacity) {
+        const size_t capacity = m->m_capacity == 0 ? INDEX_INITIAL_SIZE / 2 :
+            m->m_capacity * 2;
+        struct atf_map_entry *entries;
+
+        entries = realloc(m->m_entries, capacity * sizeof(*entries));
+        if (entries == NULL)
+            return atf_no_memory_error();
+        m->m_entries = entries;
+        m->m_capacity = capacity;
+    }
+
+    if ((m->m_size + 1) * INDEX_LOAD_INV > m->m_index_size) {
+        const size_t index_size = m->m_index_size == 0 ? INDEX_INITIAL_SIZE :
+            m->m_index_size * 2;
+        size_t *index;
+        size_t i;
+
+        index = calloc(index_size, sizeof(*index));
+        if (index == NULL)
+            return atf_no_memory_error();
+
+        for (i = 0; i < m->m_size; i++) {
+            const struct atf_map_entry *me = &m->m_entries[i];
+            index[index_slot(m->m_entries, index, index_size, entry_key(me),
+                             me->m_keylen, me->m_hash)] = i + 1;
         }
+
+        free(m->m_index);
+        m->m_index = index;
+        m->m_index_size = index_size;
     }
 
-    return me;
+    return atf_no_error();
 }
 
 /* ---------------------------------------------------------------------
@@ -75,17 +209,15 @@ new_entry(const char *key, void *value, bool managed)
 const char *
 atf_map_citer_key(const atf_map_citer_t citer)
 {
-    const struct map_entry *me = citer.m_entry;
-    PRE(me != NULL);
-    return me->m_key;
+    PRE(citer.m_entry != NULL);
+    return entry_key(citer.m_entry);
 }
 
 const void *
 atf_map_citer_data(const atf_map_citer_t citer)
 {
-    const struct map_entry *me = citer.m_entry;
-    PRE(me != NULL);
-    return me->m_value;
+    PRE(citer.m_entry != NULL);
+    return citer.m_entry->m_value;
 }
 
 atf_map_citer_t
@@ -93,10 +225,12 @@ atf_map_citer_next(const atf_map_citer_t citer)
 {
     atf_map_citer_t newciter;
 
+    PRE(citer.m_pos < citer.m_map->m_size);
+
     newciter = citer;
-    newciter.m_listiter = atf_list_citer_next(citer.m_listiter);
-    newciter.m_entry = ((const struct map_entry *)
-                        atf_list_citer_data(newciter.m_listiter));
+    newciter.m_pos++;
+    newciter.m_entry = newciter.m_pos < citer.m_map->m_size ?
+        &citer.m_map->m_entries[newciter.m_pos] : NULL;
 
     return newciter;
 }
@@ -119,17 +253,15 @@ atf_equal_map_citer_map_citer(const atf_map_citer_t i1,
 const char *
 atf_map_iter_key(const atf_map_iter_t iter)
 {
-    const struct map_entry *me = iter.m_entry;
-    PRE(me != NULL);
-    return me->m_key;
+    PRE(iter.m_entry != NULL);
+    return entry_key(iter.m_entry);
 }
 
 void *
 atf_map_iter_data(const atf_map_iter_t iter)
 {
-    const struct map_entry *me = iter.m_entry;
-    PRE(me != NULL);
-    return me->m_value;
+    PRE(iter.m_entry != NULL);
+    return iter.m_entry->m_value;
 }
 
 atf_map_iter_t
@@ -137,10 +269,12 @@ atf_map_iter_next(const atf_map_iter_t iter)
 {
     atf_map_iter_t newiter;
 
+    PRE(iter.m_pos < iter.m_map->m_size);
+
     newiter = iter;
-    newiter.m_listiter = atf_list_iter_next(iter.m_listiter);
-    newiter.m_entry = ((struct map_entry *)
-                       atf_list_iter_data(newiter.m_listiter));
+    newiter.m_pos++;
+    newiter.m_entry = newiter.m_pos < iter.m_map->m_size ?
+        &iter.m_map->m_entries[newiter.m_pos] : NULL;
 
     return newiter;
 }
@@ -163,7 +297,13 @@ atf_equal_map_iter_map_iter(const atf_map_iter_t i1,
 atf_error_t
 atf_map_init(atf_map_t *m)
 {
-    return atf_list_init(&m->m_list);
+    m->m_entries = NULL;
+    m->m_size = 0;
+    m->m_capacity = 0;
+    m->m_index = NULL;
+    m->m_index_size = 0;
+    m->m_arena = NULL;
+    return atf_no_error();
 }
 
 atf_error_t
@@ -176,6 +316,7 @@ atf_map_init_charpp(atf_map_t *m, const char *const *array)
     if (array != NULL) {
         while (!atf_is_error(err) && *ptr != NULL) {
             const char *key, *value;
+            char *copy;
 
             key = *ptr;
             INV(key != NULL);
@@ -188,7 +329,13 @@ atf_map_init_charpp(atf_map_t *m, const char *const *array)
             }
             ptr++;
 
-            err = atf_map_insert(m, key, strdup(value), true);
+            /* The values are owned by the map, so they can live in its
+             * arena instead of being allocated one by one. */
+            copy = arena_strdup(m, value, strlen(value));
+            if (copy == NULL)
+                err = atf_no_memory_error();
+            else
+                err = atf_map_insert(m, key, copy, false);
         }
     }
 
@@ -201,17 +348,22 @@ atf_map_init_charpp(atf_map_t *m, const char *const *array)
 void
 atf_map_fini(atf_map_t *m)
 {
-    atf_list_iter_t iter;
-
-    atf_list_for_each(iter, &m->m_list) {
-        struct map_entry *me = atf_list_iter_data(iter);
+    struct atf_map_chunk *chunk;
+    size_t i;
 
-        if (me->m_managed)
-            free(me->m_value);
-        free(me->m_key);
-        free(me);
+    for (i = 0; i < m->m_size; i++) {
+        if (m->m_entries[i].m_managed)
+            free(m->m_entries[i].m_value);
+    }
+    free(m->m_entries);
+    free(m->m_index);
+
+    chunk = m->m_arena;
+    while (chunk != NULL) {
+        struct atf_map_chunk *next = chunk->m_next;
+        free(chunk);
+        chunk = next;
     }
-    atf_list_fini(&m->m_list);
 }
 
 /*
@@ -223,8 +375,8 @@ atf_map_begin(atf_map_t *m)
 {
     atf_map_iter_t iter;
     iter.m_map = m;
-    iter.m_listiter = atf_list_begin(&m->m_list);
-    iter.m_entry = atf_list_iter_data(iter.m_listiter);
+    iter.m_pos = 0;
+    iter.m_entry = m->m_size > 0 ? &m->m_entries[0] : NULL;
     return iter;
 }
 
@@ -233,8 +385,8 @@ atf_map_begin_c(const atf_map_t *m)
 {
     atf_map_citer_t citer;
     citer.m_map = m;
-    citer.m_listiter = atf_list_begin_c(&m->m_list);
-    citer.m_entry = atf_list_citer_data(citer.m_listiter);
+    citer.m_pos = 0;
+    citer.m_entry = m->m_size > 0 ? &m->m_entries[0] : NULL;
     return citer;
 }
 
@@ -243,8 +395,8 @@ atf_map_end(atf_map_t *m)
 {
     atf_map_iter_t iter;
     iter.m_map = m;
+    iter.m_pos = m->m_size;
     iter.m_entry = NULL;
-    iter.m_listiter = atf_list_end(&m->m_list);
     return iter;
 }
 
@@ -253,26 +405,22 @@ atf_map_end_c(const atf_map_t *m)
 {
     atf_map_citer_t iter;
     iter.m_map = m;
+    iter.m_pos = m->m_size;
     iter.m_entry = NULL;
-    iter.m_listiter = atf_list_end_c(&m->m_list);
     return iter;
 }
 
 atf_map_iter_t
 atf_map_find(atf_map_t *m, const char *key)
 {
-    atf_list_iter_t iter;
-
-    atf_list_for_each(iter, &m->m_list) {
-        struct map_entry *me = atf_list_iter_data(iter);
-
-        if (strcmp(me->m_key, key) == 0) {
-            atf_map_iter_t i;
-            i.m_map = m;
-            i.m_entry = me;
-            i.m_listiter = iter;
-            return i;
-        }
+    const size_t pos = find_pos(m, key);
+
+    if (pos < m->m_size) {
+        atf_map_iter_t i;
+        i.m_map = m;
+        i.m_pos = pos;
+        i.m_entry = &m->m_entries[pos];
+        return i;
     }
 
     return atf_map_end(m);
@@ -281,18 +429,14 @@ atf_map_find(atf_map_t *m, const char *key)
 atf_map_citer_t
 atf_map_find_c(const atf_map_t *m, const char *key)
 {
-    atf_list_citer_t iter;
-
-    atf_list_for_each_c(iter, &m->m_list) {
-        const struct map_entry *me = atf_list_citer_data(iter);
-
-        if (strcmp(me->m_key, key) == 0) {
-            atf_map_citer_t i;
-            i.m_map = m;
-            i.m_entry = me;
-            i.m_listiter = iter;
-            return i;
-        }
+    const size_t pos = find_pos(m, key);
+
+    if (pos < m->m_size) {
+        atf_map_citer_t i;
+        i.m_map = m;
+        i.m_pos = pos;
+        i.m_entry = &m->m_entries[pos];
+        return i;
     }
 
     return atf_map_end_c(m);
@@ -301,7 +445,7 @@ atf_map_find_c(const atf_map_t *m, const char *key)
 size_t
 atf_map_size(const atf_map_t *m)
 {
-    return atf_list_size(&m->m_list);
+    return m->m_size;
 }
 
 char **
@@ -346,33 +490,47 @@ out:
 atf_error_t
 atf_map_insert(atf_map_t *m, const char *key, void *value, bool managed)
 {
-    struct map_entry *me;
+    struct atf_map_entry *me;
     atf_error_t err;
-    atf_map_iter_t iter;
+    size_t len, hash, slot;
+
+    err = reserve(m);
+    if (atf_is_error(err)) {
+        if (managed)
+            free(value);
+        return err;
+    }
 
-    iter = atf_map_find(m, key);
-    if (atf_equal_map_iter_map_iter(iter, atf_map_end(m))) {
-        me = new_entry(key, value, managed);
-        if (me == NULL)
-            err = atf_no_memory_error();
+    len = strlen(key);
+    hash = hash_key(key, len);
+    slot = index_slot(m->m_entries, m->m_index, m->m_index_size, key, len,
+                      hash);
+    if (m->m_index[slot] == 0) {
+        me = &m->m_entries[m->m_size];
+        if (len < INLINE_KEY_SIZE)
+            memcpy(me->m_key.m_inline, key, len + 1);
         else {
-            err = atf_list_append(&m->m_list, me, false);
-            if (atf_is_error(err)) {
+            me->m_key.m_ptr = arena_strdup(m, key, len);
+            if (me->m_key.m_ptr == NULL) {
                 if (managed)
                     free(value);
-                free(me);
+                return atf_no_memory_error();
             }
         }
+        me->m_keylen = len;
+        me->m_hash = hash;
+        me->m_value = value;
+        me->m_managed = managed;
+
+        m->m_index[slot] = ++m->m_size;
     } else {
-        me = iter.m_entry;
+        me = &m->m_entries[m->m_index[slot] - 1];
         if (me->m_managed)
             free(me->m_value);
 
-        INV(strcmp(me->m_key, key) == 0);
+        INV(strcmp(entry_key(me), key) == 0);
         me->m_value = value;
         me->m_managed = managed;
-
-        err = atf_no_error();
     }
 
     return err;
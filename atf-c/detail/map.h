@@ -28,18 +28,21 @@
 
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stddef.h>
 
-#include <atf-c/detail/list.h>
 #include <atf-c/error_fwd.h>
 
+struct atf_map_chunk;
+struct atf_map_entry;
+
 /* ---------------------------------------------------------------------
  * The "atf_map_citer" type.
  * --------------------------------------------------------------------- */
 
 struct atf_map_citer {
     const struct atf_map *m_map;
-    const void *m_entry;
-    atf_list_citer_t m_listiter;
+    const struct atf_map_entry *m_entry;
+    size_t m_pos;
 };
 typedef struct atf_map_citer atf_map_citer_t;
 
@@ -58,8 +61,8 @@ bool atf_equal_map_citer_map_citer(const atf_map_citer_t,
 
 struct atf_map_iter {
     struct atf_map *m_map;
-    void *m_entry;
-    atf_list_iter_t m_listiter;
+    struct atf_map_entry *m_entry;
+    size_t m_pos;
 };
 typedef struct atf_map_iter atf_map_iter_t;
 
@@ -76,10 +79,23 @@ bool atf_equal_map_iter_map_iter(const atf_map_iter_t,
  * The "atf_map" type.
  * --------------------------------------------------------------------- */
 
-/* A list-based map.  Typically very inefficient, but our maps are small
- * enough. */
+/* An open-addressing hash map that preserves insertion order.
+ *
+ * The entries are stored contiguously in insertion order, which is also the
+ * iteration order, and are looked up through a separate index of entry
+ * positions.  Short keys are stored inline in the entries and longer ones
+ * in an arena owned by the map, so inserting a new key does not usually
+ * need an allocation of its own.  Iterators are invalidated by insertions
+ * of new keys. */
 struct atf_map {
-    atf_list_t m_list;
+    struct atf_map_entry *m_entries;
+    size_t m_size;
+    size_t m_capacity;
+
+    size_t *m_index;
+    size_t m_index_size;
+
+    struct atf_map_chunk *m_arena;
 };
 typedef struct atf_map atf_map_t;
 
@@ -268,6 +268,87 @@ ATF_TC_BODY(map_insert, tc)
     atf_map_fini(&map);
 }
 
+ATF_TC(map_insert_many);
+ATF_TC_HEAD(map_insert_many, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that atf_map_insert keeps the "
+                      "insertion order and finds all keys after the map "
+                      "has grown several times");
+}
+ATF_TC_BODY(map_insert_many, tc)
+{
+    atf_map_t map;
+    atf_map_citer_t iter;
+    char key[64];
+    size_t i;
+    static int nums[1000];
+
+    RE(atf_map_init(&map));
+
+    for (i = 0; i < 1000; i++) {
+        nums[i] = i;
+        if (i % 2 == 0)
+            snprintf(key, sizeof(key), "k%zd", i);
+        else
+            snprintf(key, sizeof(key), "a-rather-long-key-that-is-not-inline-"
+                     "%zd", i);
+        RE(atf_map_insert(&map, key, &nums[i], false));
+    }
+    ATF_REQUIRE_EQ(atf_map_size(&map), 1000);
+
+    i = 0;
+    atf_map_for_each_c(iter, &map) {
+        ATF_REQUIRE_EQ(*(const int *)atf_map_citer_data(iter), (int)i);
+        if (i % 2 == 0)
+            snprintf(key, sizeof(key), "k%zd", i);
+        else
+            snprintf(key, sizeof(key), "a-rather-long-key-that-is-not-inline-"
+                     "%zd", i);
+        ATF_REQUIRE_STREQ(atf_map_citer_key(iter), key);
+
+        iter = atf_map_find_c(&map, key);
+        ATF_REQUIRE(!atf_equal_map_citer_map_citer(iter, atf_map_end_c(&map)));
+        ATF_REQUIRE_EQ(atf_map_citer_data(iter), &nums[i]);
+        i++;
+    }
+    ATF_REQUIRE_EQ(i, 1000);
+
+    iter = atf_map_find_c(&map, "k1");
+    ATF_REQUIRE(atf_equal_map_citer_map_citer(iter, atf_map_end_c(&map)));
+
+    atf_map_fini(&map);
+}
+
+ATF_TC(map_insert_managed);
+ATF_TC_HEAD(map_insert_managed, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Checks that atf_map_insert replaces "
+                      "managed values in place");
+}
+ATF_TC_BODY(map_insert_managed, tc)
+{
+    atf_map_t map;
+    atf_map_citer_t iter;
+
+    RE(atf_map_init(&map));
+
+    RE(atf_map_insert(&map, "K1", strdup("first"), true));
+    RE(atf_map_insert(&map, "K2", strdup("second"), true));
+    RE(atf_map_insert(&map, "K1", strdup("third"), true));
+    ATF_REQUIRE_EQ(atf_map_size(&map), 2);
+
+    iter = atf_map_begin_c(&map);
+    ATF_REQUIRE_STREQ(atf_map_citer_key(iter), "K1");
+    ATF_REQUIRE_STREQ((const char *)atf_map_citer_data(iter), "third");
+    iter = atf_map_citer_next(iter);
+    ATF_REQUIRE_STREQ(atf_map_citer_key(iter), "K2");
+    ATF_REQUIRE_STREQ((const char *)atf_map_citer_data(iter), "second");
+    iter = atf_map_citer_next(iter);
+    ATF_REQUIRE(atf_equal_map_citer_map_citer(iter, atf_map_end_c(&map)));
+
+    atf_map_fini(&map);
+}
+
 /*
  * Macros.
  */
@@ -409,6 +490,8 @@ ATF_TP_ADD_TCS(tp)
 
     /* Modifiers. */
     ATF_TP_ADD_TC(tp, map_insert);
+    ATF_TP_ADD_TC(tp, map_insert_many);
+    ATF_TP_ADD_TC(tp, map_insert_managed);
 
     /* Macros. */
     ATF_TP_ADD_TC(tp, map_for_each);
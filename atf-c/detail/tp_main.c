@@ -27,7 +27,12 @@
 #include "config.h"
 #endif
 
+#include <sys/types.h>
+#include <sys/stat.h>
+
 #include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -37,8 +42,12 @@
 #include "atf-c/detail/dynstr.h"
 #include "atf-c/detail/env.h"
 #include "atf-c/detail/fs.h"
+#include "atf-c/detail/list.h"
+#include "atf-c/detail/listing.h"
 #include "atf-c/detail/map.h"
+#include "atf-c/detail/process.h"
 #include "atf-c/detail/sanity.h"
+#include "atf-c/detail/usage.h"
 #include "atf-c/error.h"
 #include "atf-c/tc.h"
 #include "atf-c/tp.h"
@@ -130,17 +139,39 @@ print_warning(const char *message)
     fprintf(stderr, "%s: WARNING: %s\n", progname, message);
 }
 
+/** Reports an error as a warning and frees it. */
+static
+void
+print_error_as_warning(const atf_error_t err)
+{
+    char buf[4096];
+
+    PRE(atf_is_error(err));
+
+    atf_error_format(err, buf, sizeof(buf));
+    print_warning(buf);
+    atf_error_free(err);
+}
+
 /* ---------------------------------------------------------------------
  * Options handling.
  * --------------------------------------------------------------------- */
 
 struct params {
     bool m_do_list;
+    bool m_do_serve;
+    const char *m_listcache;
     atf_fs_path_t m_srcdir;
     char *m_tcname;
     enum tc_part m_tcpart;
     atf_fs_path_t m_resfile;
+    bool m_resfile_set;
     atf_map_t m_config;
+
+    /* Valid only in batch mode, i.e. if m_batchdir is not NULL. */
+    const char *m_batchdir;
+    const char *m_tclist;
+    atf_list_t m_tcargs;
 };
 
 static
@@ -168,8 +199,13 @@ params_init(struct params *p, const char *argv0)
     atf_error_t err;
 
     p->m_do_list = false;
+    p->m_do_serve = false;
+    p->m_listcache = NULL;
     p->m_tcname = NULL;
     p->m_tcpart = BODY;
+    p->m_resfile_set = false;
+    p->m_batchdir = NULL;
+    p->m_tclist = NULL;
 
     err = argv0_to_dir(argv0, &p->m_srcdir);
     if (atf_is_error(err))
@@ -188,6 +224,14 @@ params_init(struct params *p, const char *argv0)
         return err;
     }
 
+    err = atf_list_init(&p->m_tcargs);
+    if (atf_is_error(err)) {
+        atf_map_fini(&p->m_config);
+        atf_fs_path_fini(&p->m_resfile);
+        atf_fs_path_fini(&p->m_srcdir);
+        return err;
+    }
+
     return err;
 }
 
@@ -195,6 +239,7 @@ static
 void
 params_fini(struct params *p)
 {
+    atf_list_fini(&p->m_tcargs);
     atf_map_fini(&p->m_config);
     atf_fs_path_fini(&p->m_resfile);
     atf_fs_path_fini(&p->m_srcdir);
@@ -240,46 +285,185 @@ replace_path_param(atf_fs_path_t *param, const char *value)
     return err;
 }
 
+static
+atf_error_t
+add_tcarg(atf_list_t *tcargs, const char *tcarg)
+{
+    char *copy;
+
+    copy = strdup(tcarg);
+    if (copy == NULL)
+        return atf_no_memory_error();
+
+    return atf_list_append(tcargs, copy, true);
+}
+
+/** Appends the test case names listed in a file to the batch.
+ *
+ * The file holds one test case name per line, optionally suffixed by a
+ * part specifier as it would be given on the command line.  Blank lines
+ * and lines starting with a '#' are ignored. */
+static
+atf_error_t
+read_tclist(const char *path, atf_list_t *tcargs)
+{
+    atf_error_t err;
+    char *line;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd == -1)
+        return user_error("Cannot open test case list `%s': %s", path,
+                          strerror(errno));
+
+    err = atf_no_error();
+    while (!atf_is_error(err) && (line = atf_utils_readline(fd)) != NULL) {
+        if (line[0] != '\0' && line[0] != '#')
+            err = add_tcarg(tcargs, line);
+        free(line);
+    }
+
+    close(fd);
+    return err;
+}
+
 /* ---------------------------------------------------------------------
  * Test case listing.
  * --------------------------------------------------------------------- */
 
 static
-void
-list_tcs(const atf_tp_t *tp)
+atf_error_t
+format_tcs(const atf_tp_t *tp, atf_dynstr_t *listing)
 {
+    atf_error_t err;
     const atf_tc_t **tcs;
     const atf_tc_t *const *tcsptr;
 
-    printf("Content-Type: application/X-atf-tp; version=\"1\"\n\n");
+    err = atf_dynstr_init_fmt(listing, "Content-Type: application/X-atf-tp; "
+                              "version=\"1\"\n\n");
+    if (atf_is_error(err))
+        goto out;
 
     tcs = atf_tp_get_tcs(tp);
-    INV(tcs != NULL);  /* Should be checked. */
-    for (tcsptr = tcs; *tcsptr != NULL; tcsptr++) {
+    if (tcs == NULL) {
+        err = atf_no_memory_error();
+        goto out_listing;
+    }
+    for (tcsptr = tcs; !atf_is_error(err) && *tcsptr != NULL; tcsptr++) {
         const atf_tc_t *tc = *tcsptr;
         char **vars = atf_tc_get_md_vars(tc);
         char **ptr;
 
-        INV(vars != NULL);  /* Should be checked. */
+        if (vars == NULL) {
+            err = atf_no_memory_error();
+            break;
+        }
 
         if (tcsptr != tcs)  /* Not first. */
-            printf("\n");
+            err = atf_dynstr_append_fmt(listing, "\n");
 
-        for (ptr = vars; *ptr != NULL; ptr += 2) {
+        for (ptr = vars; !atf_is_error(err) && *ptr != NULL; ptr += 2) {
             if (strcmp(*ptr, "ident") == 0) {
-                printf("ident: %s\n", *(ptr + 1));
+                err = atf_dynstr_append_fmt(listing, "ident: %s\n",
+                                            *(ptr + 1));
                 break;
             }
         }
 
-        for (ptr = vars; *ptr != NULL; ptr += 2) {
+        for (ptr = vars; !atf_is_error(err) && *ptr != NULL; ptr += 2) {
             if (strcmp(*ptr, "ident") != 0) {
-                printf("%s: %s\n", *ptr, *(ptr + 1));
+                err = atf_dynstr_append_fmt(listing, "%s: %s\n", *ptr,
+                                            *(ptr + 1));
             }
         }
 
         atf_utils_free_charpp(vars);
     }
+    free(tcs);
+
+out_listing:
+    if (atf_is_error(err))
+        atf_dynstr_fini(listing);
+out:
+    return err;
+}
+
+/** Looks for a listing of the test program cached by a previous run.
+ *
+ * The cache file is keyed by the binary and the configuration.  Problems
+ * with it are not fatal: they are reported and the listing is recomputed. */
+static
+bool
+find_listing(const struct params *p, const char *key, atf_dynstr_t *listing)
+{
+    atf_error_t err;
+    bool found;
+
+    found = false;
+    if (key != NULL) {
+        err = atf_listing_read_cache(p->m_listcache, key, listing, &found);
+        if (atf_is_error(err))
+            print_error_as_warning(err);
+    }
+    return found;
+}
+
+static
+atf_error_t
+list_tcs(const atf_tp_t *tp, const struct params *p)
+{
+    atf_error_t err;
+    atf_dynstr_t key, listing;
+    atf_fs_path_t exe;
+    bool has_key;
+
+    err = atf_fs_path_init_fmt(&exe, "%s/%s",
+        (const char *)atf_map_citer_data(atf_map_find_c(&p->m_config,
+                                                         "srcdir")),
+        progname);
+    if (atf_is_error(err))
+        goto out;
+
+    has_key = false;
+    if (p->m_listcache != NULL) {
+        char **config = atf_tp_get_config(tp);
+        if (config == NULL) {
+            err = atf_no_memory_error();
+            goto out_exe;
+        }
+        err = atf_listing_cache_key(&exe, (const char *const *)config, &key);
+        atf_utils_free_charpp(config);
+        if (atf_is_error(err))
+            print_error_as_warning(err);
+        else
+            has_key = true;
+    }
+
+    if (!find_listing(p, has_key ? atf_dynstr_cstring(&key) : NULL,
+                      &listing)) {
+        err = format_tcs(tp, &listing);
+        if (atf_is_error(err))
+            goto out_key;
+
+        if (has_key) {
+            atf_error_t err2 = atf_listing_write_cache(
+                p->m_listcache, atf_dynstr_cstring(&key),
+                atf_dynstr_cstring(&listing));
+            if (atf_is_error(err2))
+                print_error_as_warning(err2);
+        }
+    }
+
+    printf("%s", atf_dynstr_cstring(&listing));
+    atf_dynstr_fini(&listing);
+
+out_key:
+    if (has_key)
+        atf_dynstr_fini(&key);
+out_exe:
+    atf_fs_path_fini(&exe);
+out:
+    return err;
 }
 
 /* ---------------------------------------------------------------------
@@ -334,14 +518,31 @@ process_params(int argc, char **argv, struct params *p)
     old_opterr = opterr;
     opterr = 0;
     while (!atf_is_error(err) &&
-           (ch = getopt(argc, argv, GETOPT_POSIX ":lr:s:v:")) != -1) {
+           (ch = getopt(argc, argv, GETOPT_POSIX ":C:Sb:f:lr:s:v:")) != -1) {
         switch (ch) {
         case 'l':
             p->m_do_list = true;
             break;
 
+        case 'b':
+            p->m_batchdir = optarg;
+            break;
+
+        case 'C':
+            p->m_listcache = optarg;
+            break;
+
+        case 'f':
+            p->m_tclist = optarg;
+            break;
+
+        case 'S':
+            p->m_do_serve = true;
+            break;
+
         case 'r':
             err = replace_path_param(&p->m_resfile, optarg);
+            p->m_resfile_set = true;
             break;
 
         case 's':
@@ -372,9 +573,32 @@ process_params(int argc, char **argv, struct params *p)
 #endif
 
     if (!atf_is_error(err)) {
-        if (p->m_do_list) {
+        if (p->m_tclist != NULL && p->m_batchdir == NULL)
+            err = usage_error("-f can only be used together with -b");
+        else if (p->m_listcache != NULL && !p->m_do_list)
+            err = usage_error("-C can only be used together with -l");
+        else if (p->m_do_serve) {
+            if (argc > 0)
+                err = usage_error("Cannot provide test case names with -S");
+            else if (p->m_do_list || p->m_batchdir != NULL ||
+                     p->m_resfile_set)
+                err = usage_error("-S cannot be combined with -b, -l nor -r");
+        } else if (p->m_do_list) {
             if (argc > 0)
                 err = usage_error("Cannot provide test case names with -l");
+            else if (p->m_batchdir != NULL)
+                err = usage_error("Cannot use -b together with -l");
+        } else if (p->m_batchdir != NULL) {
+            int i;
+
+            if (p->m_resfile_set)
+                err = usage_error("Cannot use -r together with -b");
+            for (i = 0; !atf_is_error(err) && i < argc; i++)
+                err = add_tcarg(&p->m_tcargs, argv[i]);
+            if (!atf_is_error(err) && p->m_tclist != NULL)
+                err = read_tclist(p->m_tclist, &p->m_tcargs);
+            if (!atf_is_error(err) && atf_list_size(&p->m_tcargs) == 0)
+                err = usage_error("Must provide at least one test case name");
         } else {
             if (argc == 0)
                 err = usage_error("Must provide a test case name");
@@ -478,6 +702,61 @@ out:
     return err;
 }
 
+static
+void
+warn_if_uncontrolled(void)
+{
+    if (!atf_env_has("__RUNNING_INSIDE_ATF_RUN") || strcmp(atf_env_get(
+        "__RUNNING_INSIDE_ATF_RUN"), "internal-yes-value") != 0)
+    {
+        print_warning("Running test cases outside of kyua(1) is unsupported");
+        print_warning("No isolation nor timeout control is being applied; you "
+                      "may get unexpected failures; see atf-test-case(4)");
+    }
+}
+
+static
+int
+run_tc_part(const atf_tp_t *tp, const char *tcname, const enum tc_part tcpart,
+            const char *resfile)
+{
+    atf_error_t err;
+    int exitcode;
+
+    err = atf_no_error(); /* Silence GCC warning. */
+    switch (tcpart) {
+    case BODY:
+        err = atf_tp_run(tp, tcname, resfile);
+        break;
+
+    case CLEANUP:
+        if (atf_tc_get_config_var_as_bool_wd(atf_tp_get_tc(tp, tcname),
+                                             ATF_USAGE_CONFIG_VAR, false)) {
+            atf_usage_t usage;
+
+            atf_usage_start(&usage);
+            err = atf_tp_cleanup(tp, tcname);
+            if (!atf_is_error(err))
+                err = atf_usage_append(&usage, "cleanup", resfile);
+        } else
+            err = atf_tp_cleanup(tp, tcname);
+        break;
+
+    default:
+        UNREACHABLE;
+    }
+
+    if (atf_is_error(err)) {
+        /* TODO: Handle error */
+        exitcode = EXIT_FAILURE;
+        atf_error_free(err);
+    } else {
+        exitcode = EXIT_SUCCESS;
+    }
+
+    return exitcode;
+}
+
 static
 atf_error_t
 run_tc(const atf_tp_t *tp, struct params *p, int *exitcode)
@@ -491,44 +770,729 @@ run_tc(const atf_tp_t *tp, struct params *p, int *exitcode)
         goto out;
     }
 
-    if (!atf_env_has("__RUNNING_INSIDE_ATF_RUN") || strcmp(atf_env_get(
-        "__RUNNING_INSIDE_ATF_RUN"), "internal-yes-value") != 0)
-    {
-        print_warning("Running test cases outside of kyua(1) is unsupported");
-        print_warning("No isolation nor timeout control is being applied; you "
-                      "may get unexpected failures; see atf-test-case(4)");
+    warn_if_uncontrolled();
+
+    *exitcode = run_tc_part(tp, p->m_tcname, p->m_tcpart,
+                            atf_fs_path_cstring(&p->m_resfile));
+
+    INV(!atf_is_error(err));
+out:
+    return err;
+}
+
+/* ---------------------------------------------------------------------
+ * Forked test cases.
+ * --------------------------------------------------------------------- */
+
+/*
+ * Both the batch and the server modes run each test case in a child process
+ * forked from the already-initialized test program.  This keeps the
+ * isolation between test cases while paying the cost of exec'ing the test
+ * program and of registering its test cases only once.
+ */
+
+struct tc_child {
+    const atf_tp_t *m_tp;
+    const char *m_tcname;
+    enum tc_part m_tcpart;
+    atf_fs_path_t m_resfile;
+    atf_fs_path_t m_workdir;
+};
+
+static
+atf_error_t
+make_absolute(atf_fs_path_t *path)
+{
+    atf_error_t err;
+    atf_fs_path_t abspath;
+
+    if (atf_fs_path_is_absolute(path))
+        return atf_no_error();
+
+    err = atf_fs_path_to_absolute(path, &abspath);
+    if (!atf_is_error(err)) {
+        atf_fs_path_fini(path);
+        *path = abspath;
     }
 
-    switch (p->m_tcpart) {
-    case BODY:
-        err = atf_tp_run(tp, p->m_tcname, atf_fs_path_cstring(&p->m_resfile));
-        if (atf_is_error(err)) {
-            /* TODO: Handle error */
+    return err;
+}
+
+static
+atf_error_t
+ensure_dir(const atf_fs_path_t *dir)
+{
+    if (mkdir(atf_fs_path_cstring(dir), 0755) == -1 && errno != EEXIST)
+        return atf_libc_error(errno, "Cannot create directory %s",
+                              atf_fs_path_cstring(dir));
+    return atf_no_error();
+}
+
+static
+void
+tc_child_start(void *v)
+{
+    const struct tc_child *tcc = v;
+    int fd;
+
+    /* The test case must not consume the input of the parent, which may be
+     * the stream of commands of the server mode. */
+    fd = open("/dev/null", O_RDONLY);
+    if (fd == -1 || dup2(fd, STDIN_FILENO) == -1) {
+        fprintf(stderr, "%s: ERROR: Cannot redirect stdin to /dev/null: %s\n",
+                progname, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    if (fd != STDIN_FILENO)
+        close(fd);
+
+    if (chdir(atf_fs_path_cstring(&tcc->m_workdir)) == -1) {
+        fprintf(stderr, "%s: ERROR: Cannot enter work directory %s: %s\n",
+                progname, atf_fs_path_cstring(&tcc->m_workdir),
+                strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    exit(run_tc_part(tcc->m_tp, tcc->m_tcname, tcc->m_tcpart,
+                     atf_fs_path_cstring(&tcc->m_resfile)));
+}
+
+static
+atf_error_t
+fork_tc(struct tc_child *tcc, const atf_process_stream_t *outsb,
+        const atf_process_stream_t *errsb, atf_process_status_t *status)
+{
+    atf_error_t err;
+    atf_process_child_t child;
+
+    /* Do not let the child flush any output buffered by the parent. */
+    fflush(stdout);
+    fflush(stderr);
+
+    err = atf_process_fork(&child, tc_child_start, outsb, errsb, tcc);
+    if (atf_is_error(err))
+        goto out;
+
+    while (atf_is_error(err = atf_process_child_wait(&child, status))) {
+        INV(atf_error_is(err, "libc") && atf_libc_error_code(err) == EINTR);
+        atf_error_free(err);
+    }
+
+out:
+    return err;
+}
+
+/** Prints how a forked test case terminated.
+ *
+ * Returns true if the test case exited successfully. */
+static
+bool
+print_status(const char *prefix, atf_process_status_t *status)
+{
+    bool success;
+
+    if (atf_process_status_exited(status)) {
+        const int exitstatus = atf_process_status_exitstatus(status);
+        printf("%sexit(%d)\n", prefix, exitstatus);
+        success = exitstatus == EXIT_SUCCESS;
+    } else {
+        INV(atf_process_status_signaled(status));
+        printf("%ssignal(%d)\n", prefix, atf_process_status_termsig(status));
+        success = false;
+    }
+    fflush(stdout);
+    atf_process_status_fini(status);
+
+    return success;
+}
+
+/* ---------------------------------------------------------------------
+ * Batch mode.
+ * --------------------------------------------------------------------- */
+
+/*
+ * Each test case of a batch gets its own directory within the batch
+ * directory, which holds the results file, the captured output of each
+ * part and a "work" subdirectory that is used as the current directory of
+ * both parts.
+ */
+
+static
+atf_error_t
+batch_run_one(const atf_tp_t *tp, const atf_fs_path_t *batchdir,
+              const char *tcarg, bool *success)
+{
+    atf_error_t err;
+    struct tc_child tcc;
+    atf_fs_path_t tcdir, outpath, errpath;
+    atf_process_stream_t outsb, errsb;
+    atf_process_status_t status;
+    atf_dynstr_t prefix;
+    char *tcname;
+    const char *part;
+
+    tcc.m_tcpart = BODY;
+    tcname = NULL;
+    err = handle_tcarg(tcarg, &tcname, &tcc.m_tcpart);
+    if (atf_is_error(err))
+        goto out_tcname;
+    tcc.m_tp = tp;
+    tcc.m_tcname = tcname;
+    part = tcc.m_tcpart == BODY ? "" : "cleanup.";
+
+    err = atf_fs_path_copy(&tcdir, batchdir);
+    if (atf_is_error(err))
+        goto out_tcname;
+    err = atf_fs_path_append_fmt(&tcdir, "%s", tcname);
+    if (atf_is_error(err))
+        goto out_tcdir;
+    err = ensure_dir(&tcdir);
+    if (atf_is_error(err))
+        goto out_tcdir;
+
+    err = atf_fs_path_copy(&tcc.m_workdir, &tcdir);
+    if (atf_is_error(err))
+        goto out_tcdir;
+    err = atf_fs_path_append_fmt(&tcc.m_workdir, "work");
+    if (atf_is_error(err))
+        goto out_workdir;
+    err = ensure_dir(&tcc.m_workdir);
+    if (atf_is_error(err))
+        goto out_workdir;
+
+    err = atf_fs_path_copy(&tcc.m_resfile, &tcdir);
+    if (atf_is_error(err))
+        goto out_workdir;
+    err = atf_fs_path_append_fmt(&tcc.m_resfile, "result");
+    if (atf_is_error(err))
+        goto out_resfile;
+
+    err = atf_fs_path_copy(&outpath, &tcdir);
+    if (atf_is_error(err))
+        goto out_resfile;
+    err = atf_fs_path_append_fmt(&outpath, "%sstdout", part);
+    if (atf_is_error(err))
+        goto out_outpath;
+
+    err = atf_fs_path_copy(&errpath, &tcdir);
+    if (atf_is_error(err))
+        goto out_outpath;
+    err = atf_fs_path_append_fmt(&errpath, "%sstderr", part);
+    if (atf_is_error(err))
+        goto out_errpath;
+
+    err = atf_process_stream_init_redirect_path(&outsb, &outpath);
+    if (atf_is_error(err))
+        goto out_errpath;
+    err = atf_process_stream_init_redirect_path(&errsb, &errpath);
+    if (atf_is_error(err))
+        goto out_outsb;
+
+    err = atf_dynstr_init_fmt(&prefix, "%s: ", tcarg);
+    if (atf_is_error(err))
+        goto out_errsb;
+
+    err = fork_tc(&tcc, &outsb, &errsb, &status);
+    if (!atf_is_error(err))
+        *success = print_status(atf_dynstr_cstring(&prefix), &status);
+
+    atf_dynstr_fini(&prefix);
+out_errsb:
+    atf_process_stream_fini(&errsb);
+out_outsb:
+    atf_process_stream_fini(&outsb);
+out_errpath:
+    atf_fs_path_fini(&errpath);
+out_outpath:
+    atf_fs_path_fini(&outpath);
+out_resfile:
+    atf_fs_path_fini(&tcc.m_resfile);
+out_workdir:
+    atf_fs_path_fini(&tcc.m_workdir);
+out_tcdir:
+    atf_fs_path_fini(&tcdir);
+out_tcname:
+    free(tcname);
+    return err;
+}
+
+static
+atf_error_t
+run_batch(const atf_tp_t *tp, struct params *p, int *exitcode)
+{
+    atf_error_t err;
+    atf_fs_path_t batchdir;
+    atf_list_citer_t iter;
+
+    /* Validate the whole batch upfront so that a typo in a test case name
+     * does not leave a partially-executed batch behind. */
+    err = atf_no_error();
+    atf_list_for_each_c(iter, &p->m_tcargs) {
+        char *tcname = NULL;
+        enum tc_part tcpart = BODY;
+
+        err = handle_tcarg(atf_list_citer_data(iter), &tcname, &tcpart);
+        if (!atf_is_error(err) && !atf_tp_has_tc(tp, tcname))
+            err = usage_error("Unknown test case `%s'", tcname);
+        free(tcname);
+        if (atf_is_error(err))
+            goto out;
+    }
+
+    err = atf_fs_path_init_fmt(&batchdir, "%s", p->m_batchdir);
+    if (atf_is_error(err))
+        goto out;
+    err = make_absolute(&batchdir);
+    if (atf_is_error(err))
+        goto out_batchdir;
+    err = ensure_dir(&batchdir);
+    if (atf_is_error(err))
+        goto out_batchdir;
+
+    warn_if_uncontrolled();
+
+    *exitcode = EXIT_SUCCESS;
+    atf_list_for_each_c(iter, &p->m_tcargs) {
+        bool success = false; /* Silence GCC warning. */
+
+        err = batch_run_one(tp, &batchdir, atf_list_citer_data(iter),
+                            &success);
+        if (atf_is_error(err))
+            break;
+        if (!success)
             *exitcode = EXIT_FAILURE;
-            atf_error_free(err);
-        } else {
-            *exitcode = EXIT_SUCCESS;
-        }
+    }
 
-        break;
+out_batchdir:
+    atf_fs_path_fini(&batchdir);
+out:
+    return err;
+}
 
-    case CLEANUP:
-        err = atf_tp_cleanup(tp, p->m_tcname);
+/* ---------------------------------------------------------------------
+ * Server mode.
+ * --------------------------------------------------------------------- */
+
+/*
+ * In server mode, the test program reads commands from stdin, one per
+ * line, and answers each of them with a single line on stdout:
+ *
+ *     run <tc>[:body|:cleanup] <resfile> <workdir> [<stdout> <stderr>]
+ *         Forks a child that enters workdir and runs the given part of the
+ *         test case, storing its result in resfile.  If given, the output
+ *         of the child is stored in the stdout and stderr files; otherwise
+ *         both go to the stderr of the server, which keeps stdout free for
+ *         the replies.  Answers "exit(<code>)" or "signal(<signo>)".
+ *     quit
+ *         Terminates the server, as does reaching the end of the input.
+ *
+ * Words are quoted like those of the batch files of atf-check.  Malformed
+ * commands are answered with "error: <message>" and do not stop the server.
+ */
+
+static
+atf_error_t
+init_abs_path(atf_fs_path_t *path, const char *str)
+{
+    atf_error_t err;
+
+    err = atf_fs_path_init_fmt(path, "%s", str);
+    if (!atf_is_error(err)) {
+        err = make_absolute(path);
+        if (atf_is_error(err))
+            atf_fs_path_fini(path);
+    }
+
+    return err;
+}
+
+static
+atf_error_t
+serve_run(const atf_tp_t *tp, const char *const *args, const size_t nargs)
+{
+    atf_error_t err;
+    struct tc_child tcc;
+    atf_fs_path_t outpath, errpath;
+    atf_process_stream_t outsb, errsb;
+    atf_process_status_t status;
+    char *tcname;
+
+    if (nargs != 3 && nargs != 5)
+        return usage_error("run takes 3 or 5 arguments; got %zu", nargs);
+
+    tcc.m_tcpart = BODY;
+    tcname = NULL;
+    err = handle_tcarg(args[0], &tcname, &tcc.m_tcpart);
+    if (atf_is_error(err))
+        goto out_tcname;
+    if (!atf_tp_has_tc(tp, tcname)) {
+        err = usage_error("Unknown test case `%s'", tcname);
+        goto out_tcname;
+    }
+    tcc.m_tp = tp;
+    tcc.m_tcname = tcname;
+
+    err = init_abs_path(&tcc.m_resfile, args[1]);
+    if (atf_is_error(err))
+        goto out_tcname;
+    err = init_abs_path(&tcc.m_workdir, args[2]);
+    if (atf_is_error(err))
+        goto out_resfile;
+
+    if (nargs == 5) {
+        err = init_abs_path(&outpath, args[3]);
+        if (atf_is_error(err))
+            goto out_workdir;
+        err = init_abs_path(&errpath, args[4]);
         if (atf_is_error(err)) {
-            /* TODO: Handle error */
-            *exitcode = EXIT_FAILURE;
-            atf_error_free(err);
+            atf_fs_path_fini(&outpath);
+            goto out_workdir;
+        }
+        err = atf_process_stream_init_redirect_path(&outsb, &outpath);
+        if (!atf_is_error(err))
+            err = atf_process_stream_init_redirect_path(&errsb, &errpath);
+    } else {
+        err = atf_process_stream_init_connect(&outsb, STDOUT_FILENO,
+                                              STDERR_FILENO);
+        if (!atf_is_error(err))
+            err = atf_process_stream_init_inherit(&errsb);
+    }
+    INV(!atf_is_error(err));  /* Stream initialization cannot fail. */
+
+    err = fork_tc(&tcc, &outsb, &errsb, &status);
+    if (!atf_is_error(err))
+        (void)print_status("", &status);
+
+    atf_process_stream_fini(&errsb);
+    atf_process_stream_fini(&outsb);
+    if (nargs == 5) {
+        atf_fs_path_fini(&errpath);
+        atf_fs_path_fini(&outpath);
+    }
+out_workdir:
+    atf_fs_path_fini(&tcc.m_workdir);
+out_resfile:
+    atf_fs_path_fini(&tcc.m_resfile);
+out_tcname:
+    free(tcname);
+    return err;
+}
+
+/** Decodes a $'...' string starting at line[*pos] and appends it to word.
+ *
+ * On success, leaves *pos at the closing quote.  Returns false if the
+ * string is not terminated. */
+static
+bool
+append_ansi_c_string(const char *line, size_t *pos, char *word, size_t *len)
+{
+    size_t i = *pos + 2;
+
+    while (line[i] != '\0' && line[i] != '\'') {
+        char c = line[i++];
+        if (c == '\\' && line[i] != '\0') {
+            c = line[i++];
+            switch (c) {
+            case 'a': c = '\a'; break;
+            case 'b': c = '\b'; break;
+            case 'e': case 'E': c = 033; break;
+            case 'f': c = '\f'; break;
+            case 'n': c = '\n'; break;
+            case 'r': c = '\r'; break;
+            case 't': c = '\t'; break;
+            case 'v': c = '\v'; break;
+            case 'x':
+                {
+                    int value = 0, count = 0;
+                    while (count < 2 && isxdigit((unsigned char)line[i])) {
+                        const char d = line[i++];
+                        value = value * 16 + (isdigit((unsigned char)d) ?
+                            d - '0' : tolower((unsigned char)d) - 'a' + 10);
+                        count++;
+                    }
+                    c = (char)value;
+                    break;
+                }
+            default:
+                if (c >= '0' && c <= '7') {
+                    int value = c - '0', count = 1;
+                    while (count < 3 && line[i] >= '0' && line[i] <= '7') {
+                        value = value * 8 + (line[i++] - '0');
+                        count++;
+                    }
+                    c = (char)value;
+                } else if (c != '\\' && c != '\'' && c != '"' && c != '?') {
+                    word[(*len)++] = '\\';
+                }
+                break;
+            }
+        }
+        word[(*len)++] = c;
+    }
+    if (line[i] == '\0')
+        return false;
+    *pos = i;
+    return true;
+}
+
+static
+atf_error_t
+append_word(atf_list_t *words, const char *word, const size_t len)
+{
+    atf_error_t err;
+    atf_dynstr_t str;
+    char *copy;
+
+    err = atf_dynstr_init_raw(&str, word, len);
+    if (atf_is_error(err))
+        return err;
+
+    copy = atf_dynstr_fini_disown(&str);
+    err = atf_list_append(words, copy, true);
+    if (atf_is_error(err))
+        free(copy);
+    return err;
+}
+
+/** Splits a command of the server mode into words.
+ *
+ * Words are quoted following the rules of sh(1), in the same way as the
+ * lines of the batch files of atf-check(1): no expansions are performed and
+ * a word starting with '#' starts a comment that extends to the end of the
+ * line.  This allows paths to contain spaces and other special characters.
+ */
+static
+atf_error_t
+split_words(const char *line, atf_list_t *words)
+{
+    atf_error_t err;
+    char *word;
+    size_t i, len;
+    bool in_word;
+
+    err = atf_list_init(words);
+    if (atf_is_error(err))
+        goto out;
+
+    /* Quotes and escapes never make a word longer than its input. */
+    word = malloc(strlen(line) + 1);
+    if (word == NULL) {
+        err = atf_no_memory_error();
+        goto err_words;
+    }
+
+    len = 0;
+    in_word = false;
+    for (i = 0; line[i] != '\0'; i++) {
+        const char ch = line[i];
+
+        if (ch == ' ' || ch == '\t') {
+            if (in_word) {
+                err = append_word(words, word, len);
+                if (atf_is_error(err))
+                    goto err_word;
+                len = 0;
+                in_word = false;
+            }
+        } else if (ch == '#' && !in_word) {
+            break;
+        } else if (ch == '\\') {
+            in_word = true;
+            if (line[i + 1] != '\0')
+                word[len++] = line[++i];
+        } else if (ch == '$' && line[i + 1] == '\'') {
+            in_word = true;
+            if (!append_ansi_c_string(line, &i, word, &len))
+                goto err_quote;
+        } else if (ch == '\'') {
+            const char *end = strchr(line + i + 1, '\'');
+
+            in_word = true;
+            if (end == NULL)
+                goto err_quote;
+            memcpy(word + len, line + i + 1, end - (line + i + 1));
+            len += end - (line + i + 1);
+            i = end - line;
+        } else if (ch == '"') {
+            in_word = true;
+            for (i++; line[i] != '\0' && line[i] != '"'; i++) {
+                if (line[i] == '\\' && line[i + 1] != '\0' &&
+                    strchr("$`\"\\", line[i + 1]) != NULL)
+                    i++;
+                word[len++] = line[i];
+            }
+            if (line[i] == '\0')
+                goto err_quote;
         } else {
-            *exitcode = EXIT_SUCCESS;
+            in_word = true;
+            word[len++] = ch;
         }
+    }
+    if (in_word) {
+        err = append_word(words, word, len);
+        if (atf_is_error(err))
+            goto err_word;
+    }
 
-        break;
+    free(word);
+    goto out;
 
-    default:
-        UNREACHABLE;
+err_quote:
+    err = usage_error("Unterminated quote in `%s'", line);
+err_word:
+    free(word);
+err_words:
+    atf_list_fini(words);
+out:
+    return err;
+}
+
+/** Processes a single command of the server mode.
+ *
+ * Errors caused by the command itself are reported to the client and are
+ * not propagated; only those that prevent the server from continuing are.
+ */
+static
+atf_error_t
+serve_command(const atf_tp_t *tp, const char *line, bool *quit)
+{
+    atf_error_t err;
+    atf_list_t words;
+    char **args;
+    size_t nargs;
+
+    err = split_words(line, &words);
+    if (atf_is_error(err))
+        goto out;
+
+    nargs = atf_list_size(&words);
+    args = atf_list_to_charpp(&words);
+    if (args == NULL) {
+        err = atf_no_memory_error();
+        goto out_words;
     }
 
-    INV(!atf_is_error(err));
+    if (nargs == 0)
+        err = atf_no_error();
+    else if (strcmp(args[0], "quit") == 0 && nargs == 1)
+        *quit = true;
+    else if (strcmp(args[0], "run") == 0)
+        err = serve_run(tp, (const char *const *)args + 1, nargs - 1);
+    else
+        err = usage_error("Unknown command `%s'", line);
+
+    atf_utils_free_charpp(args);
+out_words:
+    atf_list_fini(&words);
+out:
+    if (atf_is_error(err) && atf_error_is(err, "usage")) {
+        char buf[4096];
+
+        atf_error_format(err, buf, sizeof(buf));
+        atf_error_free(err);
+        printf("error: %s\n", buf);
+        fflush(stdout);
+        err = atf_no_error();
+    }
+
+    return err;
+}
+
+/** A buffered reader of the lines of a file descriptor.
+ *
+ * The server owns its standard input (the test cases it runs get
+ * /dev/null instead), so it can read ahead of the line it processes. */
+struct line_reader {
+    int m_fd;
+    char m_buf[4096];
+    size_t m_pos;
+    size_t m_len;
+};
+
+static
+void
+line_reader_init(struct line_reader *r, const int fd)
+{
+    r->m_fd = fd;
+    r->m_pos = 0;
+    r->m_len = 0;
+}
+
+/** Reads the next line, without its trailing newline.
+ *
+ * Sets eof to true, and leaves the line empty, if there was nothing left
+ * to read. */
+static
+atf_error_t
+line_reader_next(struct line_reader *r, atf_dynstr_t *line, bool *eof)
+{
+    atf_error_t err;
+    bool done, partial;
+
+    atf_dynstr_clear(line);
+    err = atf_no_error();
+    done = false;
+    partial = false;
+    *eof = false;
+    while (!atf_is_error(err) && !done) {
+        const char *start, *nl;
+        size_t len;
+
+        if (r->m_pos == r->m_len) {
+            const ssize_t cnt = read(r->m_fd, r->m_buf, sizeof(r->m_buf));
+            if (cnt == -1) {
+                if (errno != EINTR)
+                    err = atf_libc_error(errno, "Failed to read line");
+                continue;
+            } else if (cnt == 0) {
+                *eof = !partial;
+                break;
+            }
+            r->m_pos = 0;
+            r->m_len = cnt;
+        }
+
+        start = r->m_buf + r->m_pos;
+        nl = memchr(start, '\n', r->m_len - r->m_pos);
+        len = nl == NULL ? r->m_len - r->m_pos : (size_t)(nl - start);
+        err = atf_dynstr_append_fmt(line, "%.*s", (int)len, start);
+        r->m_pos += len;
+        if (nl != NULL) {
+            r->m_pos++;
+            done = true;
+        }
+        partial = true;
+    }
+    return err;
+}
+
+static
+atf_error_t
+run_server(const atf_tp_t *tp, int *exitcode)
+{
+    atf_error_t err;
+    atf_dynstr_t line;
+    struct line_reader reader;
+    bool eof, quit;
+
+    err = atf_dynstr_init(&line);
+    if (atf_is_error(err))
+        goto out;
+
+    warn_if_uncontrolled();
+
+    line_reader_init(&reader, STDIN_FILENO);
+    quit = false;
+    while (!quit &&
+           !atf_is_error(err = line_reader_next(&reader, &line, &eof)) &&
+           !eof) {
+        err = serve_command(tp, atf_dynstr_cstring(&line), &quit);
+        if (atf_is_error(err))
+            break;
+    }
+    *exitcode = atf_is_error(err) ? EXIT_FAILURE : EXIT_SUCCESS;
+
+    atf_dynstr_fini(&line);
 out:
     return err;
 }
@@ -567,9 +1531,13 @@ controlled_main(int argc, char **argv,
         goto out_tp;
 
     if (p.m_do_list) {
-        list_tcs(&tp);
-        INV(!atf_is_error(err));
-        *exitcode = EXIT_SUCCESS;
+        err = list_tcs(&tp, &p);
+        if (!atf_is_error(err))
+            *exitcode = EXIT_SUCCESS;
+    } else if (p.m_do_serve) {
+        err = run_server(&tp, exitcode);
+    } else if (p.m_batchdir != NULL) {
+        err = run_batch(&tp, &p, exitcode);
     } else {
         err = run_tc(&tp, &p, exitcode);
     }
@@ -0,0 +1,225 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#include "atf-c/detail/usage.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "atf-c/detail/sanity.h"
+#include "atf-c/error.h"
+
+/* ---------------------------------------------------------------------
+ * Auxiliary functions.
+ * --------------------------------------------------------------------- */
+
+static
+void
+take_snapshot(atf_usage_t *u)
+{
+    /* These calls can only fail when given invalid arguments. */
+    if (clock_gettime(CLOCK_MONOTONIC, &u->m_wall) == -1)
+        UNREACHABLE;
+    if (getrusage(RUSAGE_SELF, &u->m_rusage) == -1)
+        UNREACHABLE;
+}
+
+/** Computes the difference between two timestamps in microseconds. */
+static
+long long
+timespec_delta(const struct timespec *start, const struct timespec *end)
+{
+    return (long long)(end->tv_sec - start->tv_sec) * 1000000 +
+           (end->tv_nsec - start->tv_nsec) / 1000;
+}
+
+static
+long long
+timeval_delta(const struct timeval *start, const struct timeval *end)
+{
+    return (long long)(end->tv_sec - start->tv_sec) * 1000000 +
+           (end->tv_usec - start->tv_usec);
+}
+
+/* ---------------------------------------------------------------------
+ * Free functions.
+ * --------------------------------------------------------------------- */
+
+/** Records the current time and resource usage of the process. */
+void
+atf_usage_start(atf_usage_t *u)
+{
+    take_snapshot(u);
+}
+
+/** Computes the resources consumed since a snapshot. */
+void
+atf_usage_measure(const atf_usage_t *start, atf_usage_delta_t *delta)
+{
+    atf_usage_t now;
+
+    take_snapshot(&now);
+    delta->m_wall_us = timespec_delta(&start->m_wall, &now.m_wall);
+    delta->m_user_us = timeval_delta(&start->m_rusage.ru_utime,
+                                     &now.m_rusage.ru_utime);
+    delta->m_sys_us = timeval_delta(&start->m_rusage.ru_stime,
+                                    &now.m_rusage.ru_stime);
+#if defined(__APPLE__)
+    delta->m_maxrss_kb = now.m_rusage.ru_maxrss / 1024;  /* In bytes. */
+#else
+    delta->m_maxrss_kb = now.m_rusage.ru_maxrss;
+#endif
+    delta->m_minflt = now.m_rusage.ru_minflt - start->m_rusage.ru_minflt;
+    delta->m_majflt = now.m_rusage.ru_majflt - start->m_rusage.ru_majflt;
+    delta->m_nvcsw = now.m_rusage.ru_nvcsw - start->m_rusage.ru_nvcsw;
+    delta->m_nivcsw = now.m_rusage.ru_nivcsw - start->m_rusage.ru_nivcsw;
+}
+
+/** Formats the resources consumed since a snapshot as a results file line.
+ *
+ * The line describes the given test case part and contains the fields of
+ * atf_usage_delta_t: the elapsed wall time, the user and system CPU times,
+ * the maximum resident set size and the number of page faults and context
+ * switches.  The output dynamic string is initialized by this function.
+ */
+atf_error_t
+atf_usage_format(const atf_usage_t *start, const char *part,
+                 atf_dynstr_t *line)
+{
+    atf_usage_delta_t d;
+
+    atf_usage_measure(start, &d);
+    return atf_dynstr_init_fmt(line, "usage: %s wall=%lld.%06lld "
+        "user=%lld.%06lld sys=%lld.%06lld maxrss=%ld minflt=%ld majflt=%ld "
+        "nvcsw=%ld nivcsw=%ld\n", part,
+        d.m_wall_us / 1000000, d.m_wall_us % 1000000,
+        d.m_user_us / 1000000, d.m_user_us % 1000000,
+        d.m_sys_us / 1000000, d.m_sys_us % 1000000, d.m_maxrss_kb,
+        d.m_minflt, d.m_majflt, d.m_nvcsw, d.m_nivcsw);
+}
+
+/** Writes the resources consumed since a snapshot to an open file. */
+atf_error_t
+atf_usage_write(const atf_usage_t *start, const char *part, const int fd)
+{
+    atf_error_t err;
+    atf_dynstr_t line;
+    const char *data;
+    size_t length;
+
+    err = atf_usage_format(start, part, &line);
+    if (atf_is_error(err))
+        goto out;
+
+    data = atf_dynstr_cstring(&line);
+    length = atf_dynstr_length(&line);
+    while (length > 0) {
+        const ssize_t cnt = write(fd, data, length);
+        if (cnt == -1) {
+            if (errno != EINTR) {
+                err = atf_libc_error(errno, "Failed to write resource usage");
+                break;
+            }
+        } else {
+            data += cnt;
+            length -= cnt;
+        }
+    }
+
+    atf_dynstr_fini(&line);
+out:
+    return err;
+}
+
+/** Opens the usage file that goes with a results file.
+ *
+ * The usage lines are kept out of the results file, which callers expect to
+ * hold a single line, and go to the file named after it with a '.usage'
+ * suffix instead.  The file is truncated unless append is true.  If the
+ * results are sent to /dev/stdout or /dev/stderr, the usage lines are
+ * printed to the standard error.
+ */
+atf_error_t
+atf_usage_open(const char *resfile, const bool append, int *fd)
+{
+    atf_error_t err;
+    atf_dynstr_t path;
+
+    if (strcmp(resfile, "/dev/stdout") == 0 ||
+        strcmp(resfile, "/dev/stderr") == 0) {
+        *fd = STDERR_FILENO;
+        return atf_no_error();
+    }
+
+    err = atf_dynstr_init_fmt(&path, "%s.usage", resfile);
+    if (atf_is_error(err))
+        return err;
+
+    *fd = open(atf_dynstr_cstring(&path), O_WRONLY | O_CREAT | O_CLOEXEC |
+               (append ? O_APPEND : O_TRUNC),
+               S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (*fd == -1)
+        err = atf_libc_error(errno, "Cannot open usage file '%s'",
+                             atf_dynstr_cstring(&path));
+
+    atf_dynstr_fini(&path);
+    return err;
+}
+
+/** Closes a file descriptor returned by atf_usage_open. */
+void
+atf_usage_close(const int fd)
+{
+
+    if (fd != STDERR_FILENO)
+        close(fd);
+}
+
+/** Appends the resources consumed since a snapshot to the usage file that
+ * goes with a results file.
+ *
+ * The lines already in the usage file, such as the one of the body of the
+ * test case, are preserved.
+ */
+atf_error_t
+atf_usage_append(const atf_usage_t *start, const char *part,
+                 const char *resfile)
+{
+    atf_error_t err;
+    int fd;
+
+    err = atf_usage_open(resfile, true, &fd);
+    if (atf_is_error(err))
+        return err;
+
+    err = atf_usage_write(start, part, fd);
+    atf_usage_close(fd);
+    return err;
+}
@@ -0,0 +1,70 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#if !defined(ATF_C_DETAIL_USAGE_H)
+#define ATF_C_DETAIL_USAGE_H
+
+#include <sys/resource.h>
+
+#include <stdbool.h>
+#include <time.h>
+
+#include <atf-c/detail/dynstr.h>
+#include <atf-c/error_fwd.h>
+
+/* Configuration variable that enables the reporting of resource usage in
+ * a file next to the results file. */
+#define ATF_USAGE_CONFIG_VAR "atf.usage"
+
+/** Snapshot of the resources consumed by the process at a given time. */
+typedef struct atf_usage {
+    struct timespec m_wall;
+    struct rusage m_rusage;
+} atf_usage_t;
+
+/** Resources consumed since a snapshot.  The maximum resident set size,
+ * in kilobytes, is the only absolute value: it is the high-water mark of
+ * the whole process, including anything it did before the snapshot. */
+typedef struct atf_usage_delta {
+    long long m_wall_us;
+    long long m_user_us;
+    long long m_sys_us;
+    long m_maxrss_kb;
+    long m_minflt;
+    long m_majflt;
+    long m_nvcsw;
+    long m_nivcsw;
+} atf_usage_delta_t;
+
+void atf_usage_start(atf_usage_t *);
+void atf_usage_measure(const atf_usage_t *, atf_usage_delta_t *);
+atf_error_t atf_usage_format(const atf_usage_t *, const char *,
+                             atf_dynstr_t *);
+atf_error_t atf_usage_write(const atf_usage_t *, const char *, const int);
+atf_error_t atf_usage_open(const char *, const bool, int *);
+void atf_usage_close(const int);
+atf_error_t atf_usage_append(const atf_usage_t *, const char *, const char *);
+
+#endif /* !defined(ATF_C_DETAIL_USAGE_H) */
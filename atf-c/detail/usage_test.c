@@ -0,0 +1,106 @@
+/* Copyright (c) 2026 The NetBSD Foundation, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+ * CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  */
+
+#include "atf-c/detail/usage.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <atf-c.h>
+
+#include "atf-c/detail/test_helpers.h"
+#include "atf-c/utils.h"
+
+/* ---------------------------------------------------------------------
+ * Test cases for the free functions.
+ * --------------------------------------------------------------------- */
+
+ATF_TC_WITHOUT_HEAD(format);
+ATF_TC_BODY(format, tc)
+{
+    atf_usage_t usage;
+    atf_dynstr_t line;
+    long sec, usec;
+
+    atf_usage_start(&usage);
+    usleep(100000);
+    RE(atf_usage_format(&usage, "body", &line));
+
+    printf("Line: %s", atf_dynstr_cstring(&line));
+    ATF_REQUIRE(atf_utils_grep_string("^usage: body wall=[0-9]+\\.[0-9]{6} "
+        "user=[0-9]+\\.[0-9]{6} sys=[0-9]+\\.[0-9]{6} maxrss=[0-9]+ "
+        "minflt=[0-9]+ majflt=[0-9]+ nvcsw=[0-9]+ nivcsw=[0-9]+\n$",
+        atf_dynstr_cstring(&line)));
+
+    ATF_REQUIRE_EQ(2, sscanf(atf_dynstr_cstring(&line),
+                             "usage: body wall=%ld.%ld", &sec, &usec));
+    ATF_REQUIRE(sec * 1000000 + usec >= 100000);
+
+    atf_dynstr_fini(&line);
+}
+
+ATF_TC_WITHOUT_HEAD(append);
+ATF_TC_BODY(append, tc)
+{
+    atf_usage_t usage;
+
+    atf_utils_create_file("resfile", "passed\n");
+    atf_utils_create_file("resfile.usage", "usage: body wall=0.1\n");
+    atf_usage_start(&usage);
+    RE(atf_usage_append(&usage, "cleanup", "resfile"));
+
+    atf_utils_cat_file("resfile.usage", "");
+    ATF_REQUIRE(atf_utils_compare_file("resfile", "passed\n"));
+    ATF_REQUIRE(atf_utils_grep_file("^usage: body wall=", "resfile.usage"));
+    ATF_REQUIRE(atf_utils_grep_file("^usage: cleanup wall=",
+                                    "resfile.usage"));
+}
+
+ATF_TC_WITHOUT_HEAD(append_error);
+ATF_TC_BODY(append_error, tc)
+{
+    atf_usage_t usage;
+    atf_error_t err;
+
+    atf_usage_start(&usage);
+    err = atf_usage_append(&usage, "cleanup", "missing/resfile");
+    ATF_REQUIRE(atf_is_error(err));
+    ATF_REQUIRE(atf_error_is(err, "libc"));
+    atf_error_free(err);
+}
+
+/* ---------------------------------------------------------------------
+ * Main.
+ * --------------------------------------------------------------------- */
+
+ATF_TP_ADD_TCS(tp)
+{
+    ATF_TP_ADD_TC(tp, format);
+    ATF_TP_ADD_TC(tp, append);
+    ATF_TP_ADD_TC(tp, append_error);
+
+    return atf_no_error();
+}
@@ -97,6 +97,56 @@
 #define ATF_TC_CLEANUP_NAME(tc) \
     (atfu_ ## tc ## _cleanup)
 
+#define ATF_BENCH_WITHOUT_HEAD(bm) \
+    static void atfu_ ## bm ## _bench(const atf_tc_t *, const size_t); \
+    static void \
+    atfu_ ## bm ## _head(atf_tc_t *atfu_tc) \
+    { \
+        atf_error_t atfu_err = atf_tc_set_md_var(atfu_tc, "X-bench", "true"); \
+        if (atf_is_error(atfu_err)) \
+            atf_error_free(atfu_err); \
+    } \
+    ATF_BENCH_PACK(bm)
+
+#define ATF_BENCH(bm) \
+    static void atfu_ ## bm ## _bench_head(atf_tc_t *); \
+    static void atfu_ ## bm ## _bench(const atf_tc_t *, const size_t); \
+    static void \
+    atfu_ ## bm ## _head(atf_tc_t *atfu_tc) \
+    { \
+        atf_error_t atfu_err = atf_tc_set_md_var(atfu_tc, "X-bench", "true"); \
+        if (atf_is_error(atfu_err)) \
+            atf_error_free(atfu_err); \
+        atfu_ ## bm ## _bench_head(atfu_tc); \
+    } \
+    ATF_BENCH_PACK(bm)
+
+/* Internal to ATF_BENCH and ATF_BENCH_WITHOUT_HEAD. */
+#define ATF_BENCH_PACK(bm) \
+    static void \
+    atfu_ ## bm ## _body(const atf_tc_t *atfu_tc) \
+    { \
+        atf_tc_bench(atfu_tc, atfu_ ## bm ## _bench); \
+    } \
+    static atf_tc_t atfu_ ## bm ## _tc; \
+    static atf_tc_pack_t atfu_ ## bm ## _tc_pack = { \
+        .m_ident = #bm, \
+        .m_head = atfu_ ## bm ## _head, \
+        .m_body = atfu_ ## bm ## _body, \
+        .m_cleanup = NULL, \
+    }
+
+#define ATF_BENCH_HEAD(bm, tcptr) \
+    static \
+    void \
+    atfu_ ## bm ## _bench_head(atf_tc_t *tcptr ATF_DEFS_ATTRIBUTE_UNUSED)
+
+#define ATF_BENCH_BODY(bm, tcptr, iterations) \
+    static \
+    void \
+    atfu_ ## bm ## _bench(const atf_tc_t *tcptr ATF_DEFS_ATTRIBUTE_UNUSED, \
+                          const size_t iterations)
+
 #define ATF_TP_ADD_TCS(tps) \
     static atf_error_t atfu_tp_add_tcs(atf_tp_t *); \
     int atf_tp_main(int, char **, atf_error_t (*)(atf_tp_t *)); \
@@ -113,16 +163,8 @@
 #define ATF_TP_ADD_TC(tp, tc) \
     do { \
         atf_error_t atfu_err; \
-        char **atfu_config = atf_tp_get_config(tp); \
-        if (atfu_config == NULL) \
-            return atf_no_memory_error(); \
-        atfu_err = atf_tc_init_pack(&atfu_ ## tc ## _tc, \
-                                    &atfu_ ## tc ## _tc_pack, \
-                                    (const char *const *)atfu_config); \
-        atf_utils_free_charpp(atfu_config); \
-        if (atf_is_error(atfu_err)) \
-            return atfu_err; \
-        atfu_err = atf_tp_add_tc(tp, &atfu_ ## tc ## _tc); \
+        atfu_err = atf_tp_add_tc_pack(tp, &atfu_ ## tc ## _tc, \
+                                      &atfu_ ## tc ## _tc_pack); \
         if (atf_is_error(atfu_err)) \
             return atfu_err; \
     } while (0)
@@ -37,15 +37,20 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "atf-c/defs.h"
+#include "atf-c/detail/config_map.h"
 #include "atf-c/detail/env.h"
 #include "atf-c/detail/fs.h"
 #include "atf-c/detail/map.h"
 #include "atf-c/detail/sanity.h"
+#include "atf-c/detail/tc.h"
 #include "atf-c/detail/text.h"
+#include "atf-c/detail/usage.h"
 #include "atf-c/error.h"
+#include "atf-c/utils.h"
 
 /* ---------------------------------------------------------------------
  * Auxiliary functions.
@@ -60,6 +65,21 @@ enum expect_type {
     EXPECT_TIMEOUT,
 };
 
+/* Performance limits that can be set through the X-perf.<name> meta-data
+ * properties or a baseline file; see perf_limit_names. */
+enum perf_limit {
+    PERF_MAX_MS,
+    PERF_MAX_RSS_KB,
+    PERF_MAX_NS_PER_OP,
+    PERF_LIMITS
+};
+
+static const char *const perf_limit_names[PERF_LIMITS] = {
+    "max_ms",
+    "max_rss_kb",
+    "max_ns_per_op",
+};
+
 struct context {
     const atf_tc_t *tc;
     const char *resfile;
@@ -72,6 +92,16 @@ struct context {
     size_t expect_fail_count;
     int expect_exitcode;
     int expect_signo;
+
+    bool report_usage;
+    atf_usage_t usage;
+
+    size_t bench_iterations;
+    double bench_ns_per_op;
+    double bench_ci95;
+
+    bool check_perf;
+    long perf_limits[PERF_LIMITS];
 };
 
 static void context_init(struct context *, const atf_tc_t *, const char *);
@@ -84,6 +114,7 @@ static atf_error_t write_resfile(const int, const char *, const int,
                                  const atf_dynstr_t *);
 static void create_resfile(struct context *, const char *, const int,
                            atf_dynstr_t *);
+static void report_usage(struct context *);
 static void error_in_expect(struct context *, const char *, ...)
     ATF_DEFS_ATTRIBUTE_NORETURN;
 static void validate_expect(struct context *);
@@ -112,6 +143,7 @@ void atf_tc_set_resultsfile(const char *);
 static void
 context_init(struct context *ctx, const atf_tc_t *tc, const char *resfile)
 {
+    size_t i;
 
     ctx->tc = tc;
     ctx->resfilefd = -1;
@@ -123,6 +155,13 @@ context_init(struct context *ctx, const atf_tc_t *tc, const char *resfile)
     ctx->expect_fail_count = 0;
     ctx->expect_exitcode = 0;
     ctx->expect_signo = 0;
+    ctx->report_usage = false;
+    ctx->bench_iterations = 0;
+    ctx->bench_ns_per_op = 0.0;
+    ctx->bench_ci95 = 0.0;
+    ctx->check_perf = false;
+    for (i = 0; i < PERF_LIMITS; i++)
+        ctx->perf_limits[i] = -1;
 }
 
 static void
@@ -270,6 +309,35 @@ create_resfile(struct context *ctx, const char *result, const int arg,
     check_fatal_error(err);
 }
 
+/** Records the resources consumed by the body, if requested.
+ *
+ * This must only be called once the final result of the test case is
+ * known, not when an expectation is written to the results file.
+ */
+static void
+report_usage(struct context *ctx)
+{
+    atf_error_t err;
+    int fd;
+
+    if (!ctx->report_usage)
+        return;
+
+    check_fatal_error(atf_usage_open(ctx->resfile, false, &fd));
+
+    err = atf_no_error();
+    if (ctx->bench_iterations > 0 &&
+        dprintf(fd, "bench: iterations=%zu ns/op=%.2f ci95=%.2f\n",
+                ctx->bench_iterations, ctx->bench_ns_per_op,
+                ctx->bench_ci95) < 0)
+        err = atf_libc_error(errno, "Failed to write benchmark results");
+    if (!atf_is_error(err))
+        err = atf_usage_write(&ctx->usage, "body", fd);
+    atf_usage_close(fd);
+
+    check_fatal_error(err);
+}
+
 /** Fails a test case if validate_expect fails. */
 static void
 error_in_expect(struct context *ctx, const char *fmt, ...)
@@ -322,6 +390,7 @@ expected_failure(struct context *ctx, atf_dynstr_t *reason)
     check_fatal_error(atf_dynstr_prepend_fmt(reason, "%s: ",
         atf_dynstr_cstring(&ctx->expect_reason)));
     create_resfile(ctx, "expected_failure", -1, reason);
+    report_usage(ctx);
     context_close_resfile(ctx);
     exit(EXIT_SUCCESS);
 }
@@ -333,6 +402,7 @@ fail_requirement(struct context *ctx, atf_dynstr_t *reason)
         expected_failure(ctx, reason);
     } else if (ctx->expect == EXPECT_PASS) {
         create_resfile(ctx, "failed", -1, reason);
+        report_usage(ctx);
         context_close_resfile(ctx);
         exit(EXIT_FAILURE);
     } else {
@@ -369,6 +439,7 @@ pass(struct context *ctx)
             "a pass instead");
     } else if (ctx->expect == EXPECT_PASS) {
         create_resfile(ctx, "passed", -1, NULL);
+        report_usage(ctx);
         context_close_resfile(ctx);
         exit(EXIT_SUCCESS);
     } else {
@@ -382,6 +453,7 @@ static void
 skip(struct context *ctx, atf_dynstr_t *reason)
 {
     create_resfile(ctx, "skipped", -1, reason);
+    report_usage(ctx);
     context_close_resfile(ctx);
     exit(EXIT_SUCCESS);
 }
@@ -569,21 +641,55 @@ struct atf_tc_impl {
     const char *m_ident;
 
     atf_map_t m_vars;
-    atf_map_t m_config;
+    atf_config_map_t *m_config;
 
     atf_tc_head_t m_head;
     atf_tc_body_t m_body;
     atf_tc_cleanup_t m_cleanup;
+
+    /* Whether the head has yet to run.  Heads are evaluated on the first
+     * access to the metadata so that programs with many test cases only
+     * pay for the heads of the test cases they actually inspect. */
+    bool m_head_pending;
 };
 
+/** Runs the head of the test case if it has not run yet. */
+static
+void
+eval_head(const atf_tc_t *tc)
+{
+    struct atf_tc_impl *impl = tc->pimpl;
+
+    if (!impl->m_head_pending)
+        return;
+    impl->m_head_pending = false;
+
+    /* The head may be evaluated from any getter but it is always allowed
+     * to modify the test case, which is never really const. */
+    /* XXX Should the head be able to return error codes? */
+#define UNCONST(a) ((void *)(uintptr_t)(const void *)(a))
+    impl->m_head(UNCONST(tc));
+#undef UNCONST
+
+    if (strcmp(atf_tc_get_md_var(tc, "ident"), impl->m_ident) != 0) {
+        report_fatal_error("Test case head modified the read-only 'ident' "
+            "property");
+        UNREACHABLE;
+    }
+}
+
 /*
  * Constructors/destructors.
  */
 
+/** Initializes a test case that takes ownership of a reference to config.
+ *
+ * The reference is released on failure. */
+static
 atf_error_t
-atf_tc_init(atf_tc_t *tc, const char *ident, atf_tc_head_t head,
-            atf_tc_body_t body, atf_tc_cleanup_t cleanup,
-            const char *const *config)
+tc_init(atf_tc_t *tc, const char *ident, atf_tc_head_t head,
+        atf_tc_body_t body, atf_tc_cleanup_t cleanup,
+        atf_config_map_t *config)
 {
     atf_error_t err;
 
@@ -597,10 +703,8 @@ atf_tc_init(atf_tc_t *tc, const char *ident, atf_tc_head_t head,
     tc->pimpl->m_head = head;
     tc->pimpl->m_body = body;
     tc->pimpl->m_cleanup = cleanup;
-
-    err = atf_map_init_charpp(&tc->pimpl->m_config, config);
-    if (atf_is_error(err))
-        goto err;
+    tc->pimpl->m_config = config;
+    tc->pimpl->m_head_pending = false;
 
     err = atf_map_init(&tc->pimpl->m_vars);
     if (atf_is_error(err))
@@ -616,15 +720,7 @@ atf_tc_init(atf_tc_t *tc, const char *ident, atf_tc_head_t head,
             goto err_map;
     }
 
-    /* XXX Should the head be able to return error codes? */
-    if (tc->pimpl->m_head != NULL)
-        tc->pimpl->m_head(tc);
-
-    if (strcmp(atf_tc_get_md_var(tc, "ident"), ident) != 0) {
-        report_fatal_error("Test case head modified the read-only 'ident' "
-            "property");
-        UNREACHABLE;
-    }
+    tc->pimpl->m_head_pending = head != NULL;
 
     INV(!atf_is_error(err));
     return err;
@@ -632,11 +728,27 @@ atf_tc_init(atf_tc_t *tc, const char *ident, atf_tc_head_t head,
 err_map:
     atf_map_fini(&tc->pimpl->m_vars);
 err_vars:
-    atf_map_fini(&tc->pimpl->m_config);
+    free(tc->pimpl);
 err:
+    atf_config_map_unref(config);
     return err;
 }
 
+atf_error_t
+atf_tc_init(atf_tc_t *tc, const char *ident, atf_tc_head_t head,
+            atf_tc_body_t body, atf_tc_cleanup_t cleanup,
+            const char *const *config)
+{
+    atf_config_map_t *cm;
+    atf_error_t err;
+
+    err = atf_config_map_new(&cm, config);
+    if (atf_is_error(err))
+        return err;
+
+    return tc_init(tc, ident, head, body, cleanup, cm);
+}
+
 atf_error_t
 atf_tc_init_pack(atf_tc_t *tc, const atf_tc_pack_t *pack,
                  const char *const *config)
@@ -645,10 +757,19 @@ atf_tc_init_pack(atf_tc_t *tc, const atf_tc_pack_t *pack,
                        pack->m_cleanup, config);
 }
 
+atf_error_t
+atf_tc_init_pack_config(atf_tc_t *tc, const atf_tc_pack_t *pack,
+                        atf_config_map_t *config)
+{
+    return tc_init(tc, pack->m_ident, pack->m_head, pack->m_body,
+                   pack->m_cleanup, atf_config_map_ref(config));
+}
+
 void
 atf_tc_fini(atf_tc_t *tc)
 {
     atf_map_fini(&tc->pimpl->m_vars);
+    atf_config_map_unref(tc->pimpl->m_config);
     free(tc->pimpl);
 }
 
@@ -669,7 +790,7 @@ atf_tc_get_config_var(const atf_tc_t *tc, const char *name)
     atf_map_citer_t iter;
 
     PRE(atf_tc_has_config_var(tc, name));
-    iter = atf_map_find_c(&tc->pimpl->m_config, name);
+    iter = atf_map_find_c(atf_config_map_get(tc->pimpl->m_config), name);
     val = atf_map_citer_data(iter);
     INV(val != NULL);
 
@@ -760,6 +881,7 @@ atf_tc_get_md_var(const atf_tc_t *tc, const char *name)
     const char *val;
     atf_map_citer_t iter;
 
+    eval_head(tc);
     PRE(atf_tc_has_md_var(tc, name));
     iter = atf_map_find_c(&tc->pimpl->m_vars, name);
     val = atf_map_citer_data(iter);
@@ -771,16 +893,18 @@ atf_tc_get_md_var(const atf_tc_t *tc, const char *name)
 char **
 atf_tc_get_md_vars(const atf_tc_t *tc)
 {
+    eval_head(tc);
     return atf_map_to_charpp(&tc->pimpl->m_vars);
 }
 
 bool
 atf_tc_has_config_var(const atf_tc_t *tc, const char *name)
 {
+    const atf_map_t *config = atf_config_map_get(tc->pimpl->m_config);
     atf_map_citer_t end, iter;
 
-    iter = atf_map_find_c(&tc->pimpl->m_config, name);
-    end = atf_map_end_c(&tc->pimpl->m_config);
+    iter = atf_map_find_c(config, name);
+    end = atf_map_end_c(config);
     return !atf_equal_map_citer_map_citer(iter, end);
 }
 
@@ -789,6 +913,7 @@ atf_tc_has_md_var(const atf_tc_t *tc, const char *name)
 {
     atf_map_citer_t end, iter;
 
+    eval_head(tc);
     iter = atf_map_find_c(&tc->pimpl->m_vars, name);
     end = atf_map_end_c(&tc->pimpl->m_vars);
     return !atf_equal_map_citer_map_citer(iter, end);
@@ -805,6 +930,8 @@ atf_tc_set_md_var(atf_tc_t *tc, const char *name, const char *fmt, ...)
     char *value;
     va_list ap;
 
+    eval_head(tc);
+
     va_start(ap, fmt);
     err = atf_text_format_ap(&value, fmt, ap);
     va_end(ap);
@@ -844,6 +971,8 @@ static void _atf_tc_expect_signal(struct context *, const int, const char *,
     va_list);
 static void _atf_tc_expect_death(struct context *, const char *,
     va_list);
+static void _atf_tc_bench(struct context *, const atf_tc_t *,
+    atf_tc_bench_t);
 
 static void
 _atf_tc_fail(struct context *ctx, const char *fmt, va_list ap)
@@ -1040,6 +1169,249 @@ _atf_tc_set_resultsfile(struct context *ctx, const char *file)
     context_set_resfile(ctx, file);
 }
 
+/* Number of timed runs of the calibrated benchmark loop. */
+#define BENCH_SAMPLES 10
+
+/* Two-sided 95% quantile of Student's t distribution with
+ * BENCH_SAMPLES - 1 degrees of freedom. */
+#define BENCH_T95 2.262
+
+static
+double
+bench_run(const atf_tc_t *tc, atf_tc_bench_t bench, const size_t iterations)
+{
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    bench(tc, iterations);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    return (double)(end.tv_sec - start.tv_sec) * 1e9 +
+           (double)(end.tv_nsec - start.tv_nsec);
+}
+
+/* Square root by Newton's method, to avoid depending on libm. */
+static
+double
+bench_sqrt(const double x)
+{
+    double r = x > 1.0 ? x : 1.0, prev;  /* Start above the root. */
+
+    if (x <= 0.0)
+        return 0.0;
+    do {
+        prev = r;
+        r = (r + x / r) / 2.0;
+    } while (r < prev);
+    return prev;
+}
+
+/** Runs a benchmark and records its results in the context.
+ *
+ * The number of iterations is first calibrated by growing it until a single
+ * call to the benchmark takes a tenth of the time budget given by the
+ * atf.bench.time_ms configuration variable.  The calibrated loop is then
+ * timed BENCH_SAMPLES times to estimate the mean cost of an iteration and
+ * the half-width of its 95% confidence interval.
+ */
+static void
+_atf_tc_bench(struct context *ctx, const atf_tc_t *tc, atf_tc_bench_t bench)
+{
+    const long budget_ms = atf_tc_get_config_var_as_long_wd(
+        tc, "atf.bench.time_ms", 1000);
+    const double sample_ns = (double)budget_ms * 1e6 / BENCH_SAMPLES;
+    double samples[BENCH_SAMPLES], mean, var, elapsed;
+    size_t iterations, i;
+
+    if (budget_ms <= 0)
+        report_fatal_error("Invalid value for atf.bench.time_ms: %ld",
+                           budget_ms);
+
+    iterations = 1;
+    while ((elapsed = bench_run(tc, bench, iterations)) < sample_ns &&
+           iterations < 1000000000) {
+        size_t next;
+
+        /* Aim 20% past the target, growing by at most 100x at a time. */
+        if (elapsed < 1.0)
+            next = iterations * 100;
+        else
+            next = (size_t)((double)iterations * sample_ns * 1.2 / elapsed);
+        if (next > iterations * 100)
+            next = iterations * 100;
+        if (next <= iterations)
+            next = iterations + 1;
+        iterations = next;
+    }
+
+    mean = 0.0;
+    for (i = 0; i < BENCH_SAMPLES; i++) {
+        samples[i] = bench_run(tc, bench, iterations) / (double)iterations;
+        mean += samples[i];
+    }
+    mean /= BENCH_SAMPLES;
+
+    var = 0.0;
+    for (i = 0; i < BENCH_SAMPLES; i++)
+        var += (samples[i] - mean) * (samples[i] - mean);
+    var /= BENCH_SAMPLES - 1;
+
+    ctx->bench_iterations = iterations * BENCH_SAMPLES;
+    ctx->bench_ns_per_op = mean;
+    ctx->bench_ci95 = BENCH_T95 * bench_sqrt(var / BENCH_SAMPLES);
+
+    printf("%s: %zu iterations, %.2f ns/op +/- %.2f\n",
+           atf_tc_get_ident(tc), ctx->bench_iterations, ctx->bench_ns_per_op,
+           ctx->bench_ci95);
+    fflush(stdout);
+}
+
+/** Sets a performance limit given its name and textual value.
+ *
+ * The origin describes where the limit comes from for error messages.
+ */
+static void
+set_perf_limit(struct context *ctx, const char *name, const char *value,
+               const char *origin)
+{
+    atf_error_t err;
+    atf_dynstr_t reason;
+    long limit;
+    size_t i;
+
+    for (i = 0; i < PERF_LIMITS; i++)
+        if (strcmp(name, perf_limit_names[i]) == 0)
+            break;
+    if (i == PERF_LIMITS) {
+        format_reason_fmt(&reason, NULL, 0, "Unknown performance limit '%s' "
+            "in %s", name, origin);
+        fail_requirement(ctx, &reason);
+    }
+
+    err = atf_text_to_long(value, &limit);
+    if (atf_is_error(err) || limit <= 0) {
+        if (atf_is_error(err))
+            atf_error_free(err);
+        format_reason_fmt(&reason, NULL, 0, "Invalid value for performance "
+            "limit '%s' in %s; found %s", name, origin, value);
+        fail_requirement(ctx, &reason);
+    }
+
+    ctx->perf_limits[i] = limit;
+    ctx->check_perf = true;
+}
+
+/** Loads performance limits from a baseline file.
+ *
+ * The file contains one name=value line per limit, using the same names as
+ * the X-perf.<name> meta-data properties.  Empty lines and lines starting
+ * with '#' are ignored.  Relative paths are taken from the source
+ * directory of the test program.
+ */
+static void
+load_perf_baseline(struct context *ctx, const char *file)
+{
+    atf_dynstr_t path, reason;
+    char *line;
+    int fd;
+
+    if (file[0] == '/')
+        check_fatal_error(atf_dynstr_init_fmt(&path, "%s", file));
+    else
+        check_fatal_error(atf_dynstr_init_fmt(&path, "%s/%s",
+            atf_tc_get_config_var_wd(ctx->tc, "srcdir", "."), file));
+
+    fd = open(atf_dynstr_cstring(&path), O_RDONLY);
+    if (fd == -1) {
+        format_reason_fmt(&reason, NULL, 0, "Cannot open performance "
+            "baseline %s: %s", atf_dynstr_cstring(&path), strerror(errno));
+        atf_dynstr_fini(&path);
+        fail_requirement(ctx, &reason);
+    }
+
+    while ((line = atf_utils_readline(fd)) != NULL) {
+        char *eq;
+
+        if (line[0] == '\0' || line[0] == '#') {
+            free(line);
+            continue;
+        }
+
+        eq = strchr(line, '=');
+        if (eq == NULL) {
+            format_reason_fmt(&reason, NULL, 0, "Invalid line '%s' in "
+                "performance baseline %s", line, atf_dynstr_cstring(&path));
+            free(line);
+            close(fd);
+            atf_dynstr_fini(&path);
+            fail_requirement(ctx, &reason);
+        }
+        *eq = '\0';
+        set_perf_limit(ctx, line, eq + 1, atf_dynstr_cstring(&path));
+        free(line);
+    }
+
+    close(fd);
+    atf_dynstr_fini(&path);
+}
+
+/** Loads the performance limits of the test case from its meta-data.
+ *
+ * Limits given directly as meta-data take precedence over those in the
+ * X-perf.baseline file.
+ */
+static void
+load_perf_limits(struct context *ctx)
+{
+    char name[64];
+    size_t i;
+
+    if (atf_tc_has_md_var(ctx->tc, "X-perf.baseline"))
+        load_perf_baseline(ctx, atf_tc_get_md_var(ctx->tc, "X-perf.baseline"));
+
+    for (i = 0; i < PERF_LIMITS; i++) {
+        snprintf(name, sizeof(name), "X-perf.%s", perf_limit_names[i]);
+        if (atf_tc_has_md_var(ctx->tc, name))
+            set_perf_limit(ctx, perf_limit_names[i],
+                           atf_tc_get_md_var(ctx->tc, name), name);
+    }
+}
+
+/** Fails the test case if it exceeded any of its performance limits. */
+static void
+validate_perf(struct context *ctx)
+{
+    atf_usage_delta_t delta;
+    atf_dynstr_t reason;
+    const long *limits = ctx->perf_limits;
+
+    if (!ctx->check_perf)
+        return;
+
+    atf_usage_measure(&ctx->usage, &delta);
+    if (limits[PERF_MAX_MS] != -1 &&
+        delta.m_wall_us > (long long)limits[PERF_MAX_MS] * 1000) {
+        format_reason_fmt(&reason, NULL, 0, "Performance regression: body "
+            "took %lld ms; limit is %ld ms", delta.m_wall_us / 1000,
+            limits[PERF_MAX_MS]);
+        fail_requirement(ctx, &reason);
+    }
+    if (limits[PERF_MAX_RSS_KB] != -1 &&
+        delta.m_maxrss_kb > limits[PERF_MAX_RSS_KB]) {
+        format_reason_fmt(&reason, NULL, 0, "Performance regression: maximum "
+            "RSS was %ld KB; limit is %ld KB", delta.m_maxrss_kb,
+            limits[PERF_MAX_RSS_KB]);
+        fail_requirement(ctx, &reason);
+    }
+    if (limits[PERF_MAX_NS_PER_OP] != -1 && ctx->bench_iterations > 0 &&
+        ctx->bench_ns_per_op > (double)limits[PERF_MAX_NS_PER_OP]) {
+        format_reason_fmt(&reason, NULL, 0, "Performance regression: "
+            "benchmark took %.2f ns/op; limit is %ld ns/op",
+            ctx->bench_ns_per_op, limits[PERF_MAX_NS_PER_OP]);
+        fail_requirement(ctx, &reason);
+    }
+}
+
 /* ---------------------------------------------------------------------
  * Free functions.
  * --------------------------------------------------------------------- */
@@ -1050,6 +1422,11 @@ atf_error_t
 atf_tc_run(const atf_tc_t *tc, const char *resfile)
 {
     context_init(&Current, tc, resfile);
+    Current.report_usage = atf_tc_get_config_var_as_bool_wd(
+        tc, ATF_USAGE_CONFIG_VAR, false);
+    load_perf_limits(&Current);
+    if (Current.report_usage || Current.check_perf)
+        atf_usage_start(&Current.usage);
 
     tc->pimpl->m_body(tc);
 
@@ -1068,6 +1445,7 @@ atf_tc_run(const atf_tc_t *tc, const char *resfile)
             "see output for more details", Current.expect_fail_count);
         expected_failure(&Current, &reason);
     } else {
+        validate_perf(&Current);
         pass(&Current);
     }
     UNREACHABLE;
@@ -1262,6 +1640,15 @@ atf_tc_expect_timeout(const char *reason, ...)
     va_end(ap);
 }
 
+void
+atf_tc_bench(const atf_tc_t *tc, atf_tc_bench_t bench)
+{
+
+    PRE(Current.tc != NULL);
+
+    _atf_tc_bench(&Current, tc, bench);
+}
+
 /* Internal! */
 void
 atf_tc_set_resultsfile(const char *file)
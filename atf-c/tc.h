@@ -37,6 +37,7 @@ struct atf_tc;
 typedef void (*atf_tc_head_t)(struct atf_tc *);
 typedef void (*atf_tc_body_t)(const struct atf_tc *);
 typedef void (*atf_tc_cleanup_t)(const struct atf_tc *);
+typedef void (*atf_tc_bench_t)(const struct atf_tc *, const size_t);
 
 /* ---------------------------------------------------------------------
  * The "atf_tc_pack" type.
@@ -132,5 +133,6 @@ void atf_tc_check_errno(const char *, const size_t, const int,
                         const char *, const bool);
 void atf_tc_require_errno(const char *, const size_t, const int,
                           const char *, const bool);
+void atf_tc_bench(const atf_tc_t *, atf_tc_bench_t);
 
 #endif /* !defined(ATF_C_TC_H) */
@@ -49,6 +49,14 @@ ATF_TC_HEAD(test_var, tc)
     atf_tc_set_md_var(tc, "test-var", "Test text");
 }
 
+static int counting_head_calls = 0;
+
+ATF_TC_HEAD(counting, tc)
+{
+    counting_head_calls++;
+    atf_tc_set_md_var(tc, "test-var", "Test text");
+}
+
 /* ---------------------------------------------------------------------
  * Test cases for the "atf_tc_t" type.
  * --------------------------------------------------------------------- */
@@ -107,6 +115,37 @@ ATF_TC_BODY(init_pack, tcin)
     atf_tc_fini(&tc);
 }
 
+ATF_TC(lazy_head);
+ATF_TC_HEAD(lazy_head, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests that the head of a test case "
+                      "only runs once its metadata is first accessed");
+}
+ATF_TC_BODY(lazy_head, tcin)
+{
+    atf_tc_t tc;
+
+    counting_head_calls = 0;
+    RE(atf_tc_init(&tc, "test1", ATF_TC_HEAD_NAME(counting),
+                   ATF_TC_BODY_NAME(empty), NULL, NULL));
+    ATF_REQUIRE_EQ(0, counting_head_calls);
+    ATF_REQUIRE(strcmp(atf_tc_get_ident(&tc), "test1") == 0);
+    ATF_REQUIRE_EQ(0, counting_head_calls);
+    ATF_REQUIRE(atf_tc_has_md_var(&tc, "test-var"));
+    ATF_REQUIRE_EQ(1, counting_head_calls);
+    ATF_REQUIRE(strcmp(atf_tc_get_md_var(&tc, "test-var"), "Test text") == 0);
+    ATF_REQUIRE_EQ(1, counting_head_calls);
+    atf_tc_fini(&tc);
+
+    counting_head_calls = 0;
+    RE(atf_tc_init(&tc, "test1", ATF_TC_HEAD_NAME(counting),
+                   ATF_TC_BODY_NAME(empty), NULL, NULL));
+    RE(atf_tc_set_md_var(&tc, "test-var", "Overridden"));
+    ATF_REQUIRE_EQ(1, counting_head_calls);
+    ATF_REQUIRE(strcmp(atf_tc_get_md_var(&tc, "test-var"), "Overridden") == 0);
+    atf_tc_fini(&tc);
+}
+
 ATF_TC(vars);
 ATF_TC_HEAD(vars, tc)
 {
@@ -173,6 +212,7 @@ ATF_TP_ADD_TCS(tp)
     /* Add the test cases for the "atf_tcr_t" type. */
     ATF_TP_ADD_TC(tp, init);
     ATF_TP_ADD_TC(tp, init_pack);
+    ATF_TP_ADD_TC(tp, lazy_head);
     ATF_TP_ADD_TC(tp, vars);
     ATF_TP_ADD_TC(tp, config);
 
@@ -25,43 +25,112 @@
 
 #include "atf-c/tp.h"
 
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
+#include "atf-c/detail/config_map.h"
 #include "atf-c/detail/fs.h"
+#include "atf-c/detail/list.h"
 #include "atf-c/detail/map.h"
 #include "atf-c/detail/sanity.h"
+#include "atf-c/detail/tc.h"
 #include "atf-c/error.h"
 #include "atf-c/tc.h"
 
 struct atf_tp_impl {
+    /* The test cases in registration order, used for listing. */
     atf_list_t m_tcs;
-    atf_map_t m_config;
+
+    /* The configuration shared by all test cases added with
+     * atf_tp_add_tc_pack. */
+    atf_config_map_t *m_config;
+
+    /* An open-addressing hash table of the test cases keyed by their
+     * identifier, used for lookups.  The size is a power of two. */
+    const atf_tc_t **m_index;
+    size_t m_index_size;
 };
 
 /* ---------------------------------------------------------------------
  * Auxiliary functions.
  * --------------------------------------------------------------------- */
 
+/* Lowest load factor of the index is 1/INDEX_LOAD_INV. */
+#define INDEX_LOAD_INV 2
+#define INDEX_INITIAL_SIZE 64
+
+static
+size_t
+hash_ident(const char *ident)
+{
+    /* FNV-1a. */
+    uint32_t h = 2166136261u;
+
+    for (; *ident != '\0'; ident++) {
+        h ^= (unsigned char)*ident;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/** Returns the slot of the index that holds, or would hold, ident. */
+static
+size_t
+index_slot(const atf_tc_t *const *index, const size_t size, const char *ident)
+{
+    size_t i;
+
+    PRE(size > 0);
+
+    i = hash_ident(ident) & (size - 1);
+    while (index[i] != NULL && strcmp(atf_tc_get_ident(index[i]), ident) != 0)
+        i = (i + 1) & (size - 1);
+    return i;
+}
+
+/** Ensures that the index has room for one more test case. */
+static
+atf_error_t
+index_reserve(struct atf_tp_impl *impl)
+{
+    const atf_tc_t **index;
+    size_t i, size;
+
+    if ((atf_list_size(&impl->m_tcs) + 1) * INDEX_LOAD_INV <=
+        impl->m_index_size)
+        return atf_no_error();
+
+    size = impl->m_index_size == 0 ? INDEX_INITIAL_SIZE :
+        impl->m_index_size * 2;
+    index = calloc(size, sizeof(*index));
+    if (index == NULL)
+        return atf_no_memory_error();
+
+    for (i = 0; i < impl->m_index_size; i++) {
+        const atf_tc_t *tc = impl->m_index[i];
+        if (tc != NULL)
+            index[index_slot(index, size, atf_tc_get_ident(tc))] = tc;
+    }
+
+    free(impl->m_index);
+    impl->m_index = index;
+    impl->m_index_size = size;
+    return atf_no_error();
+}
+
 static
 const atf_tc_t *
 find_tc(const atf_tp_t *tp, const char *ident)
 {
-    const atf_tc_t *tc;
-    atf_list_citer_t iter;
+    const struct atf_tp_impl *impl = tp->pimpl;
 
-    tc = NULL;
-    atf_list_for_each_c(iter, &tp->pimpl->m_tcs) {
-        const atf_tc_t *tc2;
-        tc2 = atf_list_citer_data(iter);
-        if (strcmp(atf_tc_get_ident(tc2), ident) == 0) {
-            tc = tc2;
-            break;
-        }
-    }
-    return tc;
+    if (impl->m_index_size == 0)
+        return NULL;
+    return impl->m_index[index_slot(impl->m_index, impl->m_index_size,
+                                    ident)];
 }
 
 /* ---------------------------------------------------------------------
@@ -83,11 +152,14 @@ atf_tp_init(atf_tp_t *tp, const char *const *config)
     if (tp->pimpl == NULL)
         return atf_no_memory_error();
 
+    tp->pimpl->m_index = NULL;
+    tp->pimpl->m_index_size = 0;
+
     err = atf_list_init(&tp->pimpl->m_tcs);
     if (atf_is_error(err))
         goto out;
 
-    err = atf_map_init_charpp(&tp->pimpl->m_config, config);
+    err = atf_config_map_new(&tp->pimpl->m_config, config);
     if (atf_is_error(err)) {
         atf_list_fini(&tp->pimpl->m_tcs);
         goto out;
@@ -103,13 +175,13 @@ atf_tp_fini(atf_tp_t *tp)
 {
     atf_list_iter_t iter;
 
-    atf_map_fini(&tp->pimpl->m_config);
-
     atf_list_for_each(iter, &tp->pimpl->m_tcs) {
         atf_tc_t *tc = atf_list_iter_data(iter);
         atf_tc_fini(tc);
     }
     atf_list_fini(&tp->pimpl->m_tcs);
+    free(tp->pimpl->m_index);
+    atf_config_map_unref(tp->pimpl->m_config);
 
     free(tp->pimpl);
 }
@@ -121,7 +193,7 @@ atf_tp_fini(atf_tp_t *tp)
 char **
 atf_tp_get_config(const atf_tp_t *tp)
 {
-    return atf_map_to_charpp(&tp->pimpl->m_config);
+    return atf_map_to_charpp(atf_config_map_get(tp->pimpl->m_config));
 }
 
 bool
@@ -179,10 +251,37 @@ atf_tp_add_tc(atf_tp_t *tp, atf_tc_t *tc)
 
     PRE(find_tc(tp, atf_tc_get_ident(tc)) == NULL);
 
+    err = index_reserve(tp->pimpl);
+    if (atf_is_error(err))
+        goto out;
+
     err = atf_list_append(&tp->pimpl->m_tcs, tc, false);
+    if (atf_is_error(err))
+        goto out;
+
+    tp->pimpl->m_index[index_slot(tp->pimpl->m_index, tp->pimpl->m_index_size,
+                                  atf_tc_get_ident(tc))] = tc;
 
     POST(find_tc(tp, atf_tc_get_ident(tc)) != NULL);
 
+out:
+    return err;
+}
+
+atf_error_t
+atf_tp_add_tc_pack(atf_tp_t *tp, atf_tc_t *tc, const atf_tc_pack_t *pack)
+{
+    atf_error_t err;
+
+    err = atf_tc_init_pack_config(tc, pack, tp->pimpl->m_config);
+    if (atf_is_error(err))
+        goto out;
+
+    err = atf_tp_add_tc(tp, tc);
+    if (atf_is_error(err))
+        atf_tc_fini(tc);
+
+out:
     return err;
 }
 
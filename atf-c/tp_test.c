@@ -26,11 +26,192 @@
 #include "config.h"
 #include "atf-c/tp.h"
 
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
 #include <atf-c.h>
 
+#include "atf-c/detail/test_helpers.h"
+
+/* ---------------------------------------------------------------------
+ * Auxiliary functions.
+ * --------------------------------------------------------------------- */
+
+static
+void
+empty_body(const atf_tc_t *tc)
+{
+    if (tc != NULL) {}
+}
+
+/** Registers count synthetic test cases named tc<N> in tp.
+ *
+ * The test cases and their names are stored in the returned arrays, which
+ * must outlive tp. */
+static
+void
+add_synthetic_tcs(atf_tp_t *tp, const size_t count, atf_tc_t **tcs,
+                  char ***idents)
+{
+    size_t i;
+
+    *tcs = malloc(sizeof(atf_tc_t) * count);
+    ATF_REQUIRE(*tcs != NULL);
+    *idents = malloc(sizeof(char *) * count);
+    ATF_REQUIRE(*idents != NULL);
+
+    for (i = 0; i < count; i++) {
+        char buf[64];
+
+        snprintf(buf, sizeof(buf), "tc%zu", i);
+        (*idents)[i] = strdup(buf);
+        ATF_REQUIRE((*idents)[i] != NULL);
+
+        RE(atf_tc_init(&(*tcs)[i], (*idents)[i], NULL, empty_body, NULL,
+                       NULL));
+        RE(atf_tp_add_tc(tp, &(*tcs)[i]));
+    }
+}
+
+static
+void
+free_synthetic_tcs(const size_t count, atf_tc_t *tcs, char **idents)
+{
+    size_t i;
+
+    for (i = 0; i < count; i++)
+        free(idents[i]);
+    free(idents);
+    free(tcs);
+}
+
+/* ---------------------------------------------------------------------
+ * Helper test cases.
+ * --------------------------------------------------------------------- */
+
+ATF_TC(config_head1);
+ATF_TC_HEAD(config_head1, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "%s", atf_tc_get_config_var(tc, "var1"));
+}
+ATF_TC_BODY(config_head1, tc)
+{
+}
+
+ATF_TC(config_head2);
+ATF_TC_HEAD(config_head2, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "%s", atf_tc_get_config_var(tc, "var2"));
+}
+ATF_TC_BODY(config_head2, tc)
+{
+}
+
+/* ---------------------------------------------------------------------
+ * Test cases for the "atf_tp_t" type.
+ * --------------------------------------------------------------------- */
+
+ATF_TC(add_tc);
+ATF_TC_HEAD(add_tc, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests that atf_tp_add_tc registers test "
+                      "cases that can be looked up and listed in order");
+}
+ATF_TC_BODY(add_tc, tc)
+{
+    const char *const config[] = { NULL };
+    const atf_tc_t **tcs;
+    atf_tc_t *synthetic;
+    char **idents;
+    atf_tp_t tp;
+    size_t i;
+
+    RE(atf_tp_init(&tp, config));
+    ATF_REQUIRE(!atf_tp_has_tc(&tp, "tc0"));
+
+    add_synthetic_tcs(&tp, 200, &synthetic, &idents);
+
+    for (i = 0; i < 200; i++) {
+        ATF_REQUIRE(atf_tp_has_tc(&tp, idents[i]));
+        ATF_REQUIRE_EQ(&synthetic[i], atf_tp_get_tc(&tp, idents[i]));
+    }
+    ATF_REQUIRE(!atf_tp_has_tc(&tp, "tc200"));
+    ATF_REQUIRE(!atf_tp_has_tc(&tp, ""));
+
+    tcs = atf_tp_get_tcs(&tp);
+    ATF_REQUIRE(tcs != NULL);
+    for (i = 0; i < 200; i++)
+        ATF_REQUIRE_EQ(&synthetic[i], tcs[i]);
+    ATF_REQUIRE(tcs[200] == NULL);
+    free(tcs);
+
+    atf_tp_fini(&tp);
+    free_synthetic_tcs(200, synthetic, idents);
+}
+
+ATF_TC(add_tc_pack);
+ATF_TC_HEAD(add_tc_pack, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Tests that atf_tp_add_tc_pack makes the "
+                      "configuration of the test program available to the "
+                      "test cases, including their heads");
+}
+ATF_TC_BODY(add_tc_pack, tc)
+{
+    const char *const config[] = { "var1", "val1", "var2", "val2", NULL };
+    atf_tc_t *tcs[] = { &ATF_TC_NAME(config_head1),
+                        &ATF_TC_NAME(config_head2) };
+    atf_tp_t tp;
+    size_t i;
+
+    RE(atf_tp_init(&tp, config));
+    RE(atf_tp_add_tc_pack(&tp, tcs[0], &ATF_TC_PACK_NAME(config_head1)));
+    RE(atf_tp_add_tc_pack(&tp, tcs[1], &ATF_TC_PACK_NAME(config_head2)));
+
+    ATF_REQUIRE_STREQ("val1", atf_tc_get_md_var(tcs[0], "descr"));
+    ATF_REQUIRE_STREQ("val2", atf_tc_get_md_var(tcs[1], "descr"));
+    for (i = 0; i < 2; i++) {
+        ATF_REQUIRE_STREQ("val1", atf_tc_get_config_var(tcs[i], "var1"));
+        ATF_REQUIRE_STREQ("val2", atf_tc_get_config_var(tcs[i], "var2"));
+        ATF_REQUIRE(!atf_tc_has_config_var(tcs[i], "var3"));
+    }
+
+    atf_tp_fini(&tp);
+}
+
+ATF_TC(add_many_tcs);
+ATF_TC_HEAD(add_many_tcs, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Benchmarks the registration and lookup "
+                      "of a large number of test cases; lookups used to be "
+                      "linear, making registration quadratic");
+    atf_tc_set_md_var(tc, "timeout", "60");
+}
+ATF_TC_BODY(add_many_tcs, tc)
+{
+    const char *const config[] = { NULL };
+    const size_t count = 100000;
+    atf_tc_t *synthetic;
+    char **idents;
+    atf_tp_t tp;
+    size_t i;
+
+    RE(atf_tp_init(&tp, config));
+    add_synthetic_tcs(&tp, count, &synthetic, &idents);
+
+    for (i = 0; i < count; i++)
+        ATF_REQUIRE_EQ(&synthetic[i], atf_tp_get_tc(&tp, idents[i]));
+
+    atf_tp_fini(&tp);
+    free_synthetic_tcs(count, synthetic, idents);
+}
+
+/* ---------------------------------------------------------------------
+ * Test cases for the test program driver.
+ * --------------------------------------------------------------------- */
+
 ATF_TC(getopt);
 ATF_TC_HEAD(getopt, tc)
 {
@@ -83,6 +264,12 @@ ATF_TC_BODY(getopt, tc)
 
 ATF_TP_ADD_TCS(tp)
 {
+    /* Add the test cases for the "atf_tp_t" type. */
+    ATF_TP_ADD_TC(tp, add_tc);
+    ATF_TP_ADD_TC(tp, add_tc_pack);
+    ATF_TP_ADD_TC(tp, add_many_tcs);
+
+    /* Add the test cases for the test program driver. */
     ATF_TP_ADD_TC(tp, getopt);
 
     return atf_no_error();
@@ -73,27 +73,21 @@ init_out_filename(atf_dynstr_t *name, const pid_t pid, const char *suffix,
     }
 }
 
-/** Searches for a regexp in a string.
+/** Searches for a compiled regexp in a string.
  *
- * \param regex The regexp to look for.
+ * \param preg The compiled regexp to look for.
  * \param str The string in which to look for the expression.
  *
  * \return True if there is a match; false otherwise. */
 static
 bool
-grep_string(const char *regex, const char *str)
+grep_string(const regex_t *preg, const char *str)
 {
     int res;
-    regex_t preg;
 
-    printf("Looking for '%s' in '%s'\n", regex, str);
-    ATF_REQUIRE(regcomp(&preg, regex, REG_EXTENDED) == 0);
-
-    res = regexec(&preg, str, 0, NULL, 0);
+    res = regexec(preg, str, 0, NULL, 0);
     ATF_REQUIRE(res == 0 || res == REG_NOMATCH);
 
-    regfree(&preg);
-
     return res == 0;
 }
 
@@ -137,7 +131,36 @@ atf_utils_cat_file(const char *name, const char *prefix)
     ATF_REQUIRE(count == 0);
 }
 
+/** Compares the contents of a file, read in blocks, against a buffer.
+ *
+ * \param fd The file to read.
+ * \param contents The expected contents.
+ * \param length Length of contents.
+ *
+ * \return True if the file has exactly the expected contents. */
+static
+bool
+read_and_compare(const int fd, const char *contents, const size_t length)
+{
+    char buffer[64 * 1024];
+    size_t pos;
+    ssize_t count;
+
+    pos = 0;
+    while ((count = read(fd, buffer, sizeof(buffer))) > 0) {
+        if ((size_t)count > length - pos ||
+            memcmp(buffer, contents + pos, count) != 0)
+            return false;
+        pos += count;
+    }
+    return count == 0 && pos == length;
+}
+
 /** Compares a file against the given golden contents.
+ *
+ * The size of regular files is checked first so that files of the wrong
+ * length are rejected without reading them.  The contents are then read in
+ * large blocks, which copes with files that change while being compared.
  *
  * \param name Name of the file to be compared.
  * \param contents Expected contents of the file.
@@ -146,25 +169,20 @@ atf_utils_cat_file(const char *name, const char *prefix)
 bool
 atf_utils_compare_file(const char *name, const char *contents)
 {
+    struct stat sb;
+    bool equal;
+
     const int fd = open(name, O_RDONLY | O_CLOEXEC);
     ATF_REQUIRE_MSG(fd != -1, "Cannot open %s", name);
+    ATF_REQUIRE_MSG(fstat(fd, &sb) != -1, "Cannot stat %s", name);
 
-    const char *pos = contents;
-    ssize_t remaining = strlen(contents);
-
-    char buffer[1024];
-    ssize_t count;
-    while ((count = read(fd, buffer, sizeof(buffer))) > 0 &&
-           count <= remaining) {
-        if (memcmp(pos, buffer, count) != 0) {
-            close(fd);
-            return false;
-        }
-        remaining -= count;
-        pos += count;
-    }
+    const size_t length = strlen(contents);
+    if (S_ISREG(sb.st_mode) && (size_t)sb.st_size != length)
+        equal = false;
+    else
+        equal = read_and_compare(fd, contents, length);
     close(fd);
-    return count == 0 && remaining == 0;
+    return equal;
 }
 
 /** Copies a file.
@@ -310,6 +328,7 @@ atf_utils_grep_file(const char *regex, const char *file, ...)
     va_list ap;
     atf_dynstr_t formatted;
     atf_error_t error;
+    regex_t preg;
 
     va_start(ap, file);
     error = atf_dynstr_init_ap(&formatted, regex, ap);
@@ -318,12 +337,18 @@ atf_utils_grep_file(const char *regex, const char *file, ...)
 
     fd = open(file, O_RDONLY | O_CLOEXEC);
     ATF_REQUIRE_MSG(fd != -1, "Cannot open %s: %s", file, strerror(errno));
+
+    printf("Looking for '%s' in file '%s'\n", atf_dynstr_cstring(&formatted),
+           file);
+    ATF_REQUIRE(regcomp(&preg, atf_dynstr_cstring(&formatted),
+                        REG_EXTENDED) == 0);
     bool found = false;
     char *line = NULL;
     while (!found && (line = atf_utils_readline(fd)) != NULL) {
-        found = grep_string(atf_dynstr_cstring(&formatted), line);
+        found = grep_string(&preg, line);
         free(line);
     }
+    regfree(&preg);
     close(fd);
 
     atf_dynstr_fini(&formatted);
@@ -345,13 +370,18 @@ atf_utils_grep_string(const char *regex, const char *str, ...)
     va_list ap;
     atf_dynstr_t formatted;
     atf_error_t error;
+    regex_t preg;
 
     va_start(ap, str);
     error = atf_dynstr_init_ap(&formatted, regex, ap);
     va_end(ap);
     ATF_REQUIRE(!atf_is_error(error));
 
-    res = grep_string(atf_dynstr_cstring(&formatted), str);
+    printf("Looking for '%s' in '%s'\n", atf_dynstr_cstring(&formatted), str);
+    ATF_REQUIRE(regcomp(&preg, atf_dynstr_cstring(&formatted),
+                        REG_EXTENDED) == 0);
+    res = grep_string(&preg, str);
+    regfree(&preg);
 
     atf_dynstr_fini(&formatted);
 
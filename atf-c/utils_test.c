@@ -184,6 +184,33 @@ ATF_TC_BODY(compare_file__long__not_match, tc)
     ATF_REQUIRE(!atf_utils_compare_file("test.txt", long_contents));
 }
 
+ATF_TC_WITHOUT_HEAD(compare_file__quiet);
+ATF_TC_BODY(compare_file__quiet, tc)
+{
+    char long_contents[3456];
+    size_t i = 0;
+    for (; i < sizeof(long_contents) - 1; i++)
+        long_contents[i] = '0' + (i % 10);
+    long_contents[i] = '\0';
+    atf_utils_create_file("test.txt", "%s", long_contents);
+
+    atf_utils_redirect(STDOUT_FILENO, "captured.txt");
+    long_contents[3000] = 'Z';
+    ATF_REQUIRE(!atf_utils_compare_file("test.txt", long_contents));
+    ATF_REQUIRE(!atf_utils_compare_file("test.txt", "0123456789"));
+    fflush(stdout);
+    close(STDOUT_FILENO);
+
+    ATF_REQUIRE(atf_utils_compare_file("captured.txt", ""));
+}
+
+ATF_TC_WITHOUT_HEAD(compare_file__not_regular);
+ATF_TC_BODY(compare_file__not_regular, tc)
+{
+    ATF_REQUIRE(atf_utils_compare_file("/dev/null", ""));
+    ATF_REQUIRE(!atf_utils_compare_file("/dev/null", "foo"));
+}
+
 ATF_TC_WITHOUT_HEAD(copy_file__empty);
 ATF_TC_BODY(copy_file__empty, tc)
 {
@@ -536,6 +563,8 @@ ATF_TP_ADD_TCS(tp)
     ATF_TP_ADD_TC(tp, compare_file__short__not_match);
     ATF_TP_ADD_TC(tp, compare_file__long__match);
     ATF_TP_ADD_TC(tp, compare_file__long__not_match);
+    ATF_TP_ADD_TC(tp, compare_file__quiet);
+    ATF_TP_ADD_TC(tp, compare_file__not_regular);
 
     ATF_TP_ADD_TC(tp, copy_file__empty);
     ATF_TP_ADD_TC(tp, copy_file__some_contents);
@@ -23,17 +23,34 @@
 // OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
 // IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
 extern "C" {
 #include <sys/types.h>
+#if defined(HAVE_SYS_INOTIFY_H)
+#include <sys/inotify.h>
+#endif
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/wait.h>
 
+#include <fcntl.h>
 #include <limits.h>
+#include <poll.h>
 #include <signal.h>
 #include <stdint.h>
 #include <time.h>
 #include <unistd.h>
+
+#include "atf-c/defs.h"
+
+extern char** environ;
 }
 
+#include <algorithm>
+#include <cctype>
 #include <cerrno>
 #include <cstdlib>
 #include <cstring>
@@ -43,10 +60,11 @@ extern "C" {
 #include <iterator>
 #include <list>
 #include <memory>
+#include <sstream>
 #include <utility>
 
-#include "atf-c++/check.hpp"
 #include "atf-c++/detail/application.hpp"
+#include "atf-c++/detail/diff.hpp"
 #include "atf-c++/detail/env.hpp"
 #include "atf-c++/detail/exceptions.hpp"
 #include "atf-c++/detail/fs.hpp"
@@ -109,71 +127,6 @@ struct output_check {
     }
 };
 
-class temp_file : public std::ostream {
-    std::unique_ptr< atf::fs::path > m_path;
-    int m_fd;
-
-public:
-    temp_file(const char* pattern) :
-        std::ostream(NULL),
-        m_fd(-1)
-    {
-        const atf::fs::path file = atf::fs::path(
-            atf::env::get("TMPDIR", "/tmp")) / pattern;
-
-        std::string file_s = file.str();
-        // C++14 returns const char* with `std::string::data()`.
-        //
-        // TODO(ngie): remove the else block and simplify once we are on C++17
-        // or later.
-#if __cplusplus >= 201703L
-        char *file_ch_arr = file_s.data();
-#else
-        char *file_ch_arr = &file_s[0];
-#endif
-        m_fd = ::mkstemp(file_ch_arr);
-        if (m_fd == -1)
-            throw atf::system_error("atf_check::temp_file::temp_file(" +
-                                    file_s + ")", "mkstemp(3) failed",
-                                    errno);
-
-        m_path.reset(new atf::fs::path(file_ch_arr));
-    }
-
-    ~temp_file(void)
-    {
-        close();
-        try {
-            remove(*m_path);
-        } catch (const atf::system_error&) {
-            // Ignore deletion errors.
-        }
-    }
-
-    const atf::fs::path&
-    get_path(void) const
-    {
-        return *m_path;
-    }
-
-    void
-    write(const std::string& text)
-    {
-        if (::write(m_fd, text.c_str(), text.size()) == -1)
-            throw atf::system_error("atf_check", "write(2) failed", errno);
-    }
-
-    void
-    close(void)
-    {
-        if (m_fd != -1) {
-            flush();
-            ::close(m_fd);
-            m_fd = -1;
-        }
-    }
-};
-
 } // anonymous namespace
 
 static useconds_t
@@ -193,16 +146,16 @@ get_monotonic_useconds(void)
     return res;
 }
 
-static bool
-timo_expired(useconds_t timeout)
+static void
+sleep_useconds(const useconds_t usecs)
 {
-
-    if (get_monotonic_useconds() >= timeout)
-        return true;
-    return false;
+    struct timespec ts;
+    ts.tv_sec = usecs / seconds_in_useconds;
+    ts.tv_nsec = (usecs % seconds_in_useconds) * useconds_in_nseconds;
+    while (::nanosleep(&ts, &ts) == -1 && errno == EINTR)
+        ;
 }
 
-
 static int
 parse_exit_code(const std::string& str)
 {
@@ -350,9 +303,40 @@ parse_output_check_arg(const std::string& arg)
     return output_check(type, negated, arg.substr(delimiter + 1));
 }
 
+// Computes the repeat interval that follows the given one when backing off.
+static useconds_t
+next_interval(const useconds_t interval, const useconds_t max_interval)
+{
+    if (interval == 0)
+        return std::min(mseconds_in_useconds, max_interval);
+    else if (interval > max_interval / 2)
+        return max_interval;
+    else
+        return interval * 2;
+}
+
+static useconds_t
+parse_repeat_interval(const std::string& str)
+{
+    char *end;
+
+    // This could be a non-integer number of milliseconds, but integers were
+    // just easy to do for now.
+    errno = 0;
+    const long l = strtol(str.c_str(), &end, 10);
+    if (errno == ERANGE)
+        throw atf::application::usage_error(
+            "Bogus repeat interval in milliseconds");
+    else if (errno != 0 || str.empty() || *end != 0 || l < 0)
+        throw atf::application::usage_error(
+            "Repeat interval must be a number");
+
+    return l * mseconds_in_useconds;
+}
+
 static void
 parse_repeat_check_arg(const std::string& arg, useconds_t *m_timo,
-    useconds_t *m_interval)
+    useconds_t *m_min_interval, useconds_t *m_max_interval)
 {
     const std::string::size_type delimiter = arg.find(':');
     const bool has_interval = (delimiter != std::string::npos);
@@ -374,86 +358,64 @@ parse_repeat_check_arg(const std::string& arg, useconds_t *m_timo,
         throw atf::application::usage_error("Timeout must be a number");
 
     *m_timo = get_monotonic_useconds() + (l * seconds_in_useconds);
-    // 50 milliseconds is chosen arbitrarily.  There is a tradeoff between
-    // longer and shorter poll times.  A shorter poll time makes for faster
-    // tests.  A longer poll time makes for lower CPU overhead for the polled
-    // operation.  50ms is chosen with these tradeoffs in mind: on
-    // microcontrollers, the hope is that we can still avoid meaningful CPU use
-    // with a small test every 50ms.  And on typical fast x86 hardware, our
-    // tests can be much more precise with time wasted than they typically are
-    // without this feature.
-    *m_interval = 50 * mseconds_in_useconds;
-
-    if (!has_interval)
+
+    if (!has_interval) {
+        // Start polling quickly so that conditions that become true soon
+        // are noticed soon, and back off exponentially so that waiting for
+        // a long time does not keep the machine busy.
+        *m_min_interval = 5 * mseconds_in_useconds;
+        *m_max_interval = 500 * mseconds_in_useconds;
         return;
+    }
 
     const std::string intv_str = arg.substr(delimiter + 1, std::string::npos);
-
-    // Same -- this could be non-integer milliseconds.
-    errno = 0;
-    l = strtol(intv_str.c_str(), &end, 10);
-    if (errno == ERANGE)
-        throw atf::application::usage_error(
-            "Bogus repeat interval in milliseconds");
-    else if (errno != 0)
-        throw atf::application::usage_error(
-            "Repeat interval must be a number");
-
-    if (*end != 0)
-        throw atf::application::usage_error(
-            "Repeat interval must be a number");
-
-    *m_interval = l * mseconds_in_useconds;
+    const std::string::size_type delimiter2 = intv_str.find(':');
+    *m_min_interval = parse_repeat_interval(intv_str.substr(0, delimiter2));
+    if (delimiter2 == std::string::npos) {
+        // A single interval keeps the historical fixed polling period.
+        *m_max_interval = *m_min_interval;
+    } else {
+        *m_max_interval = parse_repeat_interval(
+            intv_str.substr(delimiter2 + 1, std::string::npos));
+        if (*m_max_interval < *m_min_interval)
+            throw atf::application::usage_error(
+                "Maximum repeat interval must not be smaller than the "
+                "minimum");
+    }
 }
 
 static
 std::string
-flatten_argv(char* const* argv)
+flatten_argv(const std::vector< std::string >& argv)
 {
     std::string cmdline;
 
-    char* const* arg = &argv[0];
-    while (*arg != NULL) {
-        if (arg != &argv[0])
+    for (std::vector< std::string >::const_iterator iter = argv.begin();
+         iter != argv.end(); iter++) {
+        if (iter != argv.begin())
             cmdline += ' ';
 
-        cmdline += *arg;
-
-        arg++;
+        cmdline += *iter;
     }
 
     return cmdline;
 }
 
-static
-std::unique_ptr< atf::check::check_result >
-execute(const char* const* argv)
-{
-    // TODO: This should go to stderr... but fixing it now may be hard as test
-    // cases out there might be relying on stderr being silent.
-    std::cout << "Executing command [ ";
-    for (int i = 0; argv[i] != NULL; ++i)
-        std::cout << argv[i] << " ";
-    std::cout << "]\n";
-    std::cout.flush();
-
-    atf::process::argv_array argva(argv);
-    return atf::check::exec(argva);
-}
+static void exec_child(void*) ATF_DEFS_ATTRIBUTE_NORETURN;
 
 static
-std::unique_ptr< atf::check::check_result >
-execute_with_shell(char* const* argv)
+void
+exec_child(void* v)
 {
-    const std::string cmd = flatten_argv(argv);
-    const std::string shell = atf::env::get("ATF_SHELL", ATF_SHELL);
-    const char* sh_argv[4];
-
-    sh_argv[0] = shell.c_str();
-    sh_argv[1] = "-c";
-    sh_argv[2] = cmd.c_str();
-    sh_argv[3] = NULL;
-    return execute(sh_argv);
+    const atf::process::argv_array* argva =
+        static_cast< const atf::process::argv_array* >(v);
+    const char* const* argv = argva->exec_argv();
+
+    ::execvp(argv[0], const_cast< char* const* >(argv));
+    std::cerr << "execvp(" << argv[0] << ") failed: " << std::strerror(errno)
+              << "\n";
+    std::cerr.flush();
+    std::exit(127);
 }
 
 static
@@ -473,90 +435,23 @@ cat_file(const atf::fs::path& path)
 }
 
 static
-bool
-grep_file(const atf::fs::path& path, const std::string& regexp)
+std::string
+read_file(const atf::fs::path& path)
 {
-    std::ifstream stream(path.c_str());
+    std::ifstream stream(path.c_str(), std::fstream::binary);
     if (!stream)
         throw std::runtime_error("Failed to open " + path.str());
 
-    bool found = false;
-
-    std::string line;
-    while (!found && !std::getline(stream, line).fail()) {
-        if (atf::text::match(line, regexp))
-            found = true;
-    }
-
-    stream.close();
-
-    return found;
-}
-
-static
-bool
-file_empty(const atf::fs::path& p)
-{
-    atf::fs::file_info f(p);
-
-    return (f.get_size() == 0);
-}
-
-static bool
-compare_files(const atf::fs::path& p1, const atf::fs::path& p2)
-{
-    bool equal = false;
-
-    std::ifstream f1(p1.c_str());
-    if (!f1)
-        throw std::runtime_error("Failed to open " + p1.str());
-
-    std::ifstream f2(p2.c_str());
-    if (!f2)
-        throw std::runtime_error("Failed to open " + p2.str());
-
-    for (;;) {
-        char buf1[512], buf2[512];
-
-        f1.read(buf1, sizeof(buf1));
-        if (f1.bad())
-            throw std::runtime_error("Failed to read from " + p1.str());
-
-        f2.read(buf2, sizeof(buf2));
-        if (f2.bad())
-            throw std::runtime_error("Failed to read from " + p2.str());
-
-        if ((f1.gcount() == 0) && (f2.gcount() == 0)) {
-            equal = true;
-            break;
-        }
-
-        if ((f1.gcount() != f2.gcount()) ||
-            (std::memcmp(buf1, buf2, f1.gcount()) != 0)) {
-            break;
-        }
-    }
-
-    return equal;
-}
-
-static
-void
-print_diff(const atf::fs::path& p1, const atf::fs::path& p2)
-{
-    const atf::process::status s =
-        atf::process::exec(atf::fs::path("diff"),
-                           atf::process::argv_array("diff", "-u", p1.c_str(),
-                                                    p2.c_str(), NULL),
-                           atf::process::stream_connect(STDOUT_FILENO,
-                                                        STDERR_FILENO),
-                           atf::process::stream_inherit());
-
-    if (!s.exited())
-        std::cerr << "Failed to run diff(3)\n";
+    std::string contents;
+    char buf[8192];
+    do {
+        stream.read(buf, sizeof(buf));
+        if (stream.bad())
+            throw std::runtime_error("Failed to read from " + path.str());
+        contents.append(buf, stream.gcount());
+    } while (stream);
 
-    if (s.exitstatus() != 1)
-        std::cerr << "Error while running diff(3)\n";
+    return contents;
 }
 
 static
@@ -604,187 +499,1661 @@ decode(const std::string& s)
     return res;
 }
 
+// Returns the offset of the first byte that differs between two buffers of
+// the same length, or the length if they are equal.
 static
-bool
-run_status_check(const status_check& sc, const atf::check::check_result& cr)
+std::string::size_type
+first_difference(const char* a, const char* b,
+                 const std::string::size_type len)
 {
-    bool result;
-
-    if (sc.type == sc_exit) {
-        if (cr.exited() && !sc.empty) {
-            const int status = cr.exitcode();
-
-            if (!sc.negated && sc.value != status) {
-                std::cerr << "Fail: incorrect exit status: "
-                          << status << ", expected: "
-                          << sc.value << "\n";
-                result = false;
-            } else if (sc.negated && sc.value == status) {
-                std::cerr << "Fail: incorrect exit status: "
-                          << status << ", expected: "
-                          << "anything else\n";
-                result = false;
-            } else
-                result = true;
-        } else if (cr.exited() && sc.empty) {
-            result = true;
-        } else {
-            std::cerr << "Fail: program did not exit cleanly\n";
-            result = false;
-        }
-    } else if (sc.type == sc_ignore) {
-        result = true;
-    } else if (sc.type == sc_signal) {
-        if (cr.signaled() && !sc.empty) {
-            const int status = cr.termsig();
-
-            if (!sc.negated && sc.value != status) {
-                std::cerr << "Fail: incorrect signal received: "
-                          << status << ", expected: " << sc.value << "\n";
-                result = false;
-            } else if (sc.negated && sc.value == status) {
-                std::cerr << "Fail: incorrect signal received: "
-                          << status << ", expected: "
-                          << "anything else\n";
-                result = false;
-            } else
-                result = true;
-        } else if (cr.signaled() && sc.empty) {
-            result = true;
-        } else {
-            std::cerr << "Fail: program did not receive a signal\n";
-            result = false;
-        }
-    } else {
-        UNREACHABLE;
-        result = false;
+    if (std::memcmp(a, b, len) == 0)
+        return len;
+
+    // Narrow down the difference in blocks to keep using memcmp(3), which
+    // is much faster than comparing byte by byte.
+    std::string::size_type pos = 0, range = len;
+    while (range > 64) {
+        const std::string::size_type half = range / 2;
+        if (std::memcmp(a + pos, b + pos, half) == 0) {
+            pos += half;
+            range -= half;
+        } else
+            range = half;
     }
+    while (a[pos] == b[pos])
+        pos++;
+    return pos;
+}
 
-    if (result == false) {
-        std::cerr << "stdout:\n";
-        cat_file(atf::fs::path(cr.stdout_path()));
-        std::cerr << "\n";
+// Looks for the first occurrence of a non-empty literal in a buffer.
+static
+const char*
+find_literal(const char* begin, const char* end, const std::string& literal)
+{
+    const std::string::size_type len = literal.length();
+    PRE(len > 0);
 
-        std::cerr << "stderr:\n";
-        cat_file(atf::fs::path(cr.stderr_path()));
-        std::cerr << "\n";
+    while (static_cast< std::string::size_type >(end - begin) >= len) {
+        const char* candidate = static_cast< const char* >(
+            std::memchr(begin, literal[0], end - begin - len + 1));
+        if (candidate == NULL)
+            break;
+        if (std::memcmp(candidate + 1, literal.data() + 1, len - 1) == 0)
+            return candidate;
+        begin = candidate + 1;
     }
 
-    return result;
+    return NULL;
 }
 
+// Checks if any of the lines in a buffer, each of which must be terminated
+// by a newline, matches a regular expression.  The buffer is searched for
+// the literal that the expression requires, if any, and only the lines
+// that contain it are handed to the regular expression engine.
 static
 bool
-run_status_checks(const std::vector< status_check >& checks,
-                  const atf::check::check_result& result)
+grep_lines(const atf::text::regex& re, const char* begin, const char* end)
 {
-    bool ok = false;
+    PRE(begin == end || end[-1] == '\n');
+    const std::string& literal = re.literal();
+
+    const char* pos = begin;
+    while (pos < end) {
+        const char* bol = pos;
+        if (!literal.empty()) {
+            const char* hit = find_literal(pos, end, literal);
+            if (hit == NULL)
+                return false;
+
+            bol = hit;
+            while (bol > pos && bol[-1] != '\n')
+                bol--;
+        }
 
-    for (std::vector< status_check >::const_iterator iter = checks.begin();
-         !ok && iter != checks.end(); iter++) {
-         ok |= run_status_check(*iter, result);
+        const char* eol = static_cast< const char* >(
+            std::memchr(bol, '\n', end - bol));
+        INV(eol != NULL);
+        if (re.matches(bol, eol))
+            return true;
+        pos = eol + 1;
     }
 
-    return ok;
+    return false;
 }
 
-static
-bool
-run_output_check(const output_check& oc, const atf::fs::path& path,
-                 const std::string& stdxxx)
-{
-    bool result;
+// ------------------------------------------------------------------------
+// Streaming evaluation of the output checks.
+// ------------------------------------------------------------------------
 
-    if (oc.type == oc_empty) {
-        const bool is_empty = file_empty(path);
-        if (!oc.negated && !is_empty) {
-            std::cerr << "Fail: " << stdxxx << " not empty\n";
-            print_diff(atf::fs::path("/dev/null"), path);
-            result = false;
-        } else if (oc.negated && is_empty) {
-            std::cerr << "Fail: " << stdxxx << " is empty\n";
-            result = false;
-        } else
-            result = true;
-    } else if (oc.type == oc_file) {
-        const bool equals = compare_files(path, atf::fs::path(oc.value));
-        if (!oc.negated && !equals) {
-            std::cerr << "Fail: " << stdxxx << " does not match golden "
-                "output\n";
-            print_diff(atf::fs::path(oc.value), path);
-            result = false;
-        } else if (oc.negated && equals) {
-            std::cerr << "Fail: " << stdxxx << " matches golden output\n";
-            cat_file(atf::fs::path(oc.value));
-            result = false;
-        } else
-            result = true;
-    } else if (oc.type == oc_ignore) {
-        result = true;
-    } else if (oc.type == oc_inline) {
-        temp_file temp("atf-check.XXXXXX");
-        temp.write(decode(oc.value));
-        temp.close();
+namespace {
 
-        const bool equals = compare_files(path, temp.get_path());
-        if (!oc.negated && !equals) {
-            std::cerr << "Fail: " << stdxxx << " does not match expected "
-                "value\n";
-            print_diff(temp.get_path(), path);
-            result = false;
-        } else if (oc.negated && equals) {
-            std::cerr << "Fail: " << stdxxx << " matches expected value\n";
-            cat_file(temp.get_path());
-            result = false;
-        } else
-            result = true;
-    } else if (oc.type == oc_match) {
-        const bool matches = grep_file(path, oc.value);
-        if (!oc.negated && !matches) {
-            std::cerr << "Fail: regexp " + oc.value + " not in " << stdxxx
-                      << "\n";
-            cat_file(path);
-            result = false;
-        } else if (oc.negated && matches) {
-            std::cerr << "Fail: regexp " + oc.value + " is in " << stdxxx
-                      << "\n";
-            cat_file(path);
-            result = false;
-        } else
-            result = true;
-    } else if (oc.type == oc_save) {
-        INV(!oc.negated);
-        std::ifstream ifs(path.c_str(), std::fstream::binary);
-        ifs >> std::noskipws;
-        std::istream_iterator< char > begin(ifs), end;
+// Amount of output of each stream kept in memory to report failures.  The
+// checks themselves see all of the output, but it is never accumulated in
+// full, so commands can produce arbitrarily large outputs.
+static const std::string::size_type max_retained_output = 4 * 1024 * 1024;
 
-        std::ofstream ofs(oc.value.c_str(), std::fstream::binary
-                                     | std::fstream::trunc);
-        std::ostream_iterator <char> obegin(ofs);
+// Maximum number of lines of differences printed for a failed check.
+static const std::size_t max_diff_lines = 1000;
 
-        std::copy(begin, end, obegin);
+// The contents of a golden file.  The file is mapped in memory if possible
+// so that the output can be compared against it without copying it.
+class golden_file {
+    std::string m_path;
+    void* m_map;
+    std::string::size_type m_size;
+    std::string m_contents;
+
+    golden_file(const golden_file&);
+    golden_file& operator=(const golden_file&);
+
+public:
+    golden_file(const std::string& path) :
+        m_path(path),
+        m_map(NULL),
+        m_size(0)
+    {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd == -1)
+            throw std::runtime_error("Failed to open " + path);
+
+        struct stat sb;
+        if (::fstat(fd, &sb) != -1 && S_ISREG(sb.st_mode) && sb.st_size > 0) {
+            void* map = ::mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd,
+                               0);
+            if (map != MAP_FAILED) {
+                m_map = map;
+                m_size = sb.st_size;
+            }
+        }
+        ::close(fd);
+
+        if (m_map == NULL) {
+            m_contents = read_file(atf::fs::path(path));
+            m_size = m_contents.length();
+        }
+    }
+
+    ~golden_file(void)
+    {
+        if (m_map != NULL)
+            ::munmap(m_map, m_size);
+    }
+
+    const char*
+    data(void)
+        const
+    {
+        return m_map != NULL ? static_cast< const char* >(m_map) :
+            m_contents.data();
+    }
+
+    std::string::size_type
+    size(void)
+        const
+    {
+        return m_size;
+    }
+};
+
+// An output check ready to be run.  Inline values are decoded, golden files
+// are loaded and regular expressions are compiled when the checker is
+// created, so that repeating the command with -r does not redo this work.
+class output_checker {
+    output_check m_check;
+    std::string m_expected;
+    std::unique_ptr< golden_file > m_golden;
+    atf::text::regex m_regex;
+
+    output_checker(const output_checker&);
+    output_checker& operator=(const output_checker&);
+
+public:
+    explicit output_checker(const output_check& check) :
+        m_check(check),
+        m_regex(check.type == oc_match ? check.value : "")
+    {
+        if (m_check.type == oc_inline) {
+            m_expected = decode(m_check.value);
+        } else if (m_check.type == oc_file) {
+            m_golden.reset(new golden_file(m_check.value));
+        }
+    }
+
+    const output_check&
+    check(void)
+        const
+    {
+        return m_check;
+    }
+
+    const atf::text::regex&
+    regex(void)
+        const
+    {
+        PRE(m_check.type == oc_match);
+        return m_regex;
+    }
+
+    const char*
+    expected_data(void)
+        const
+    {
+        return m_golden.get() != NULL ? m_golden->data() : m_expected.data();
+    }
+
+    std::string::size_type
+    expected_size(void)
+        const
+    {
+        return m_golden.get() != NULL ? m_golden->size() :
+            m_expected.length();
+    }
+
+    std::string
+    expected(void)
+        const
+    {
+        return std::string(expected_data(), expected_size());
+    }
+};
+
+// The state of a single output check, fed with the output of the command as
+// it arrives.  A check is decided once more output cannot change its result,
+// after which it ignores any further output.
+class output_state {
+    const output_checker* m_checker;
+    output_check m_check;
+    bool m_decided;
+    std::string::size_type m_size;
+
+    // Where the output first diverged from the expected contents, for the
+    // oc_file and oc_inline checks, if it did.
+    bool m_equal;
+    std::string::size_type m_mismatch;
+
+    std::string m_line;
+    bool m_matched;
+    std::unique_ptr< std::ofstream > m_save;
+
+    void
+    diverge(const std::string::size_type offset)
+    {
+        m_equal = false;
+        m_mismatch = offset;
+        m_decided = true;
+    }
+
+    // Compares a chunk of the output with the expected contents.
+    void
+    feed_expected(const char* buf, const std::string::size_type len)
+    {
+        const std::string::size_type expected_size =
+            m_checker->expected_size();
+        const std::string::size_type avail = m_size < expected_size ?
+            expected_size - m_size : 0;
+        const std::string::size_type n = std::min(len, avail);
+
+        const std::string::size_type i =
+            first_difference(m_checker->expected_data() + m_size, buf, n);
+        if (i < n || n < len)
+            diverge(m_size + i);
+    }
+
+    void
+    feed_match(const char* buf, const std::string::size_type len)
+    {
+        const char* const end = buf + len;
+
+        if (!m_line.empty()) {
+            const char* eol = static_cast< const char* >(
+                std::memchr(buf, '\n', len));
+            if (eol == NULL) {
+                m_line.append(buf, len);
+                return;
+            }
+
+            m_line.append(buf, eol - buf);
+            if (m_checker->regex().matches(m_line)) {
+                m_matched = true;
+                m_decided = true;
+                return;
+            }
+            m_line.clear();
+            buf = eol + 1;
+        }
+
+        // Scan all the complete lines at once and keep the trailing partial
+        // line, if any, for the next chunk.
+        const char* last = end;
+        while (last > buf && last[-1] != '\n')
+            last--;
+        if (grep_lines(m_checker->regex(), buf, last)) {
+            m_matched = true;
+            m_decided = true;
+            return;
+        }
+        m_line.assign(last, end - last);
+    }
+
+public:
+    output_state(const output_checker& checker) :
+        m_checker(&checker),
+        m_check(checker.check()),
+        m_decided(m_check.type == oc_ignore),
+        m_size(0),
+        m_equal(true),
+        m_mismatch(0),
+        m_matched(false)
+    {
+    }
+
+    const output_check&
+    check(void)
+        const
+    {
+        return m_check;
+    }
+
+    bool
+    decided(void)
+        const
+    {
+        return m_decided;
+    }
+
+    void
+    feed(const char* buf, const std::string::size_type len)
+    {
+        if (m_decided)
+            return;
+
+        switch (m_check.type) {
+        case oc_empty:
+            m_decided = true;
+            break;
+
+        case oc_file:
+        case oc_inline:
+            feed_expected(buf, len);
+            break;
+
+        case oc_match:
+            feed_match(buf, len);
+            break;
+
+        case oc_save:
+            // Opened on demand so that the file is not truncated before the
+            // command has had a chance to read it.
+            if (m_save.get() == NULL)
+                m_save.reset(new std::ofstream(m_check.value.c_str(),
+                    std::fstream::binary | std::fstream::trunc));
+            m_save->write(buf, len);
+            break;
+
+        default:
+            UNREACHABLE;
+        }
+
+        m_size += len;
+    }
+
+    // Processes the end of the output.
+    void
+    finish(void)
+    {
+        if (m_decided)
+            return;
+
+        if (m_check.type == oc_file || m_check.type == oc_inline) {
+            if (m_size != m_checker->expected_size())
+                diverge(m_size);
+        } else if (m_check.type == oc_match) {
+            if (!m_line.empty() && m_checker->regex().matches(m_line))
+                m_matched = true;
+        } else if (m_check.type == oc_save) {
+            if (m_save.get() == NULL)
+                m_save.reset(new std::ofstream(m_check.value.c_str(),
+                    std::fstream::binary | std::fstream::trunc));
+            m_save->close();
+        }
+        m_decided = true;
+    }
+
+    bool
+    is_empty(void)
+        const
+    {
+        PRE(m_decided);
+        return m_size == 0;
+    }
+
+    bool
+    equal(void)
+        const
+    {
+        PRE(m_decided);
+        return m_equal;
+    }
+
+    std::string::size_type
+    mismatch(void)
+        const
+    {
+        PRE(m_decided && !m_equal);
+        return m_mismatch;
+    }
+
+    bool
+    matched(void)
+        const
+    {
+        PRE(m_decided);
+        return m_matched;
+    }
+
+    std::string
+    expected(void)
+        const
+    {
+        return m_checker->expected();
+    }
+};
+
+// A stream of the command, such as its stdout, together with the checks to
+// run on it.
+class output_stream {
+    std::string m_name;
+    std::string m_text;
+    std::string::size_type m_size;
+    std::list< output_state > m_states;
+
+public:
+    output_stream(const std::string& name,
+                  const std::list< output_checker >& checkers) :
+        m_name(name),
+        m_size(0)
+    {
+        for (std::list< output_checker >::const_iterator iter =
+             checkers.begin(); iter != checkers.end(); iter++)
+            m_states.push_back(output_state(*iter));
+    }
+
+    const std::string&
+    name(void)
+        const
+    {
+        return m_name;
+    }
+
+    // The retained prefix of the output.
+    const std::string&
+    text(void)
+        const
+    {
+        return m_text;
+    }
+
+    bool
+    truncated(void)
+        const
+    {
+        return m_text.length() < m_size;
+    }
+
+    std::list< output_state >&
+    states(void)
+    {
+        return m_states;
+    }
+
+    void
+    feed(const char* buf, const std::string::size_type len)
+    {
+        if (m_text.length() < max_retained_output)
+            m_text.append(buf, std::min(len,
+                max_retained_output - m_text.length()));
+        m_size += len;
+
+        for (std::list< output_state >::iterator iter = m_states.begin();
+             iter != m_states.end(); iter++)
+            (*iter).feed(buf, len);
+    }
+
+    void
+    finish(void)
+    {
+        for (std::list< output_state >::iterator iter = m_states.begin();
+             iter != m_states.end(); iter++)
+            (*iter).finish();
+    }
+
+    void
+    print(std::ostream& os)
+        const
+    {
+        os << m_text;
+        if (truncated())
+            os << "\n[... " << (m_size - m_text.length())
+               << " more bytes not shown ...]\n";
+    }
+};
+
+// The outcome of a command.
+class exec_result {
+    bool m_exited;
+    int m_exitcode;
+    bool m_signaled;
+    int m_termsig;
+    const output_stream& m_stdout;
+    const output_stream& m_stderr;
+
+public:
+    exec_result(const atf::process::status& s, const output_stream& out,
+                const output_stream& err) :
+        m_exited(s.exited()),
+        m_exitcode(m_exited ? s.exitstatus() : -1),
+        m_signaled(s.signaled()),
+        m_termsig(m_signaled ? s.termsig() : -1),
+        m_stdout(out),
+        m_stderr(err)
+    {
+    }
+
+    bool
+    exited(void)
+        const
+    {
+        return m_exited;
+    }
+
+    int
+    exitcode(void)
+        const
+    {
+        PRE(m_exited);
+        return m_exitcode;
+    }
+
+    bool
+    signaled(void)
+        const
+    {
+        return m_signaled;
+    }
+
+    int
+    termsig(void)
+        const
+    {
+        PRE(m_signaled);
+        return m_termsig;
+    }
+
+    const output_stream&
+    stdout_stream(void)
+        const
+    {
+        return m_stdout;
+    }
+
+    const output_stream&
+    stderr_stream(void)
+        const
+    {
+        return m_stderr;
+    }
+};
+
+} // anonymous namespace
+
+static
+void
+print_diff(const std::string& label, const std::string& expected,
+           const output_stream& stream)
+{
+    atf::diff::unified(std::cerr, label, expected, stream.name(),
+                       stream.text(), max_diff_lines);
+}
+
+// Checks if the child has terminated without reaping it, so that it can
+// still be waited for later on.
+static
+bool
+child_exited(const pid_t pid)
+{
+    siginfo_t info;
+    std::memset(&info, 0, sizeof(info));
+    while (::waitid(P_PID, pid, &info, WEXITED | WNOHANG | WNOWAIT) == -1) {
+        if (errno != EINTR)
+            throw atf::system_error("atf_check", "waitid(2) failed", errno);
+    }
+    return info.si_pid == pid;
+}
+
+// Feeds the stdout and stderr pipes of a child to the checks of the
+// corresponding streams as the output arrives.  Both pipes are serviced at
+// once so that a child that fills one of them while we are blocked reading
+// the other one cannot deadlock.
+//
+// Reading stops once the child has exited and the output it left in the
+// pipes has been drained, even if the pipes are still open: a process that
+// the child left running in the background may hold them for much longer.
+static
+void
+read_pipes(const pid_t pid, const int outfd, const int errfd,
+           output_stream& out, output_stream& err)
+{
+    // How long to wait for output before checking if the child exited.
+    const int exit_check_ms = 10;
+    // Upper bound on the reads done after the child exited, in case a
+    // background process keeps writing to the pipes.
+    const int max_drain_reads = 256;
+
+    struct pollfd fds[2];
+    output_stream* streams[2] = { &out, &err };
+
+    fds[0].fd = outfd;
+    fds[0].events = POLLIN;
+    fds[1].fd = errfd;
+    fds[1].events = POLLIN;
+
+    int open = 2;
+    bool exited = false;
+    int drain_reads = 0;
+    while (open > 0) {
+        const int ready = ::poll(fds, 2, exited ? 0 : exit_check_ms);
+        if (ready == -1) {
+            if (errno == EINTR)
+                continue;
+            throw atf::system_error("atf_check", "poll(2) failed", errno);
+        } else if (ready == 0) {
+            if (exited)
+                break;
+            exited = child_exited(pid);
+            continue;
+        } else if (exited && ++drain_reads > max_drain_reads)
+            break;
+
+        for (int i = 0; i < 2; i++) {
+            if (fds[i].fd == -1 || fds[i].revents == 0)
+                continue;
+
+            char buf[8192];
+            const ssize_t n = ::read(fds[i].fd, buf, sizeof(buf));
+            if (n == -1) {
+                if (errno == EINTR)
+                    continue;
+                throw atf::system_error("atf_check", "read(2) failed",
+                                        errno);
+            } else if (n == 0) {
+                fds[i].fd = -1;
+                open--;
+            } else
+                streams[i]->feed(buf, n);
+        }
+    }
+
+    out.finish();
+    err.finish();
+}
+
+static
+std::unique_ptr< exec_result >
+execute(const char* const* argv, output_stream& out, output_stream& err)
+{
+    // TODO: This should go to stderr... but fixing it now may be hard as test
+    // cases out there might be relying on stderr being silent.
+    std::cout << "Executing command [ ";
+    for (int i = 0; argv[i] != NULL; ++i)
+        std::cout << argv[i] << " ";
+    std::cout << "]\n";
+    std::cout.flush();
+
+    atf::process::argv_array argva(argv);
+    atf::process::child c = atf::process::fork(exec_child,
+        atf::process::stream_capture(), atf::process::stream_capture(),
+        static_cast< void* >(&argva));
+
+    read_pipes(c.pid(), c.stdout_fd(), c.stderr_fd(), out, err);
+
+    const atf::process::status s = c.wait();
+    return std::unique_ptr< exec_result >(new exec_result(s, out, err));
+}
+
+static
+std::unique_ptr< exec_result >
+execute(const std::vector< std::string >& argv, output_stream& out,
+        output_stream& err)
+{
+    std::vector< const char* > array;
+    for (std::vector< std::string >::const_iterator iter = argv.begin();
+         iter != argv.end(); iter++)
+        array.push_back((*iter).c_str());
+    array.push_back(NULL);
+    return execute(&array[0], out, err);
+}
+
+static
+std::unique_ptr< exec_result >
+execute_with_shell(const std::vector< std::string >& argv,
+                   output_stream& out, output_stream& err)
+{
+    const std::string cmd = flatten_argv(argv);
+    const std::string shell = atf::env::get("ATF_SHELL", ATF_SHELL);
+    const char* sh_argv[4];
+
+    sh_argv[0] = shell.c_str();
+    sh_argv[1] = "-c";
+    sh_argv[2] = cmd.c_str();
+    sh_argv[3] = NULL;
+    return execute(sh_argv, out, err);
+}
+
+static
+bool
+run_status_check(const status_check& sc, const exec_result& cr)
+{
+    bool result;
+
+    if (sc.type == sc_exit) {
+        if (cr.exited() && !sc.empty) {
+            const int status = cr.exitcode();
+
+            if (!sc.negated && sc.value != status) {
+                std::cerr << "Fail: incorrect exit status: "
+                          << status << ", expected: "
+                          << sc.value << "\n";
+                result = false;
+            } else if (sc.negated && sc.value == status) {
+                std::cerr << "Fail: incorrect exit status: "
+                          << status << ", expected: "
+                          << "anything else\n";
+                result = false;
+            } else
+                result = true;
+        } else if (cr.exited() && sc.empty) {
+            result = true;
+        } else {
+            std::cerr << "Fail: program did not exit cleanly\n";
+            result = false;
+        }
+    } else if (sc.type == sc_ignore) {
+        result = true;
+    } else if (sc.type == sc_signal) {
+        if (cr.signaled() && !sc.empty) {
+            const int status = cr.termsig();
+
+            if (!sc.negated && sc.value != status) {
+                std::cerr << "Fail: incorrect signal received: "
+                          << status << ", expected: " << sc.value << "\n";
+                result = false;
+            } else if (sc.negated && sc.value == status) {
+                std::cerr << "Fail: incorrect signal received: "
+                          << status << ", expected: "
+                          << "anything else\n";
+                result = false;
+            } else
+                result = true;
+        } else if (cr.signaled() && sc.empty) {
+            result = true;
+        } else {
+            std::cerr << "Fail: program did not receive a signal\n";
+            result = false;
+        }
+    } else {
+        UNREACHABLE;
+        result = false;
+    }
+
+    if (result == false) {
+        std::cerr << "stdout:\n";
+        cr.stdout_stream().print(std::cerr);
+        std::cerr << "\n";
+
+        std::cerr << "stderr:\n";
+        cr.stderr_stream().print(std::cerr);
+        std::cerr << "\n";
+    }
+
+    return result;
+}
+
+static
+bool
+run_status_checks(const std::vector< status_check >& checks,
+                  const exec_result& result)
+{
+    bool ok = false;
+
+    for (std::vector< status_check >::const_iterator iter = checks.begin();
+         !ok && iter != checks.end(); iter++) {
+         ok |= run_status_check(*iter, result);
+    }
+
+    return ok;
+}
+
+static
+bool
+run_output_check(const output_state& os, const output_stream& stream)
+{
+    const output_check& oc = os.check();
+    const std::string& stdxxx = stream.name();
+    bool result;
+
+    if (oc.type == oc_empty) {
+        const bool is_empty = os.is_empty();
+        if (!oc.negated && !is_empty) {
+            std::cerr << "Fail: " << stdxxx << " not empty\n";
+            print_diff("/dev/null", "", stream);
+            result = false;
+        } else if (oc.negated && is_empty) {
+            std::cerr << "Fail: " << stdxxx << " is empty\n";
+            result = false;
+        } else
+            result = true;
+    } else if (oc.type == oc_file) {
+        const bool equals = os.equal();
+        if (!oc.negated && !equals) {
+            std::cerr << "Fail: " << stdxxx << " does not match golden "
+                "output\n";
+            std::cerr << "First difference at byte " << os.mismatch()
+                      << "\n";
+            if (!stream.truncated())
+                print_diff(oc.value, os.expected(), stream);
+            result = false;
+        } else if (oc.negated && equals) {
+            std::cerr << "Fail: " << stdxxx << " matches golden output\n";
+            cat_file(atf::fs::path(oc.value));
+            result = false;
+        } else
+            result = true;
+    } else if (oc.type == oc_ignore) {
+        result = true;
+    } else if (oc.type == oc_inline) {
+        const bool equals = os.equal();
+        if (!oc.negated && !equals) {
+            std::cerr << "Fail: " << stdxxx << " does not match expected "
+                "value\n";
+            std::cerr << "First difference at byte " << os.mismatch()
+                      << "\n";
+            if (!stream.truncated())
+                print_diff("expected", os.expected(), stream);
+            result = false;
+        } else if (oc.negated && equals) {
+            std::cerr << "Fail: " << stdxxx << " matches expected value\n";
+            std::cerr << os.expected();
+            result = false;
+        } else
+            result = true;
+    } else if (oc.type == oc_match) {
+        const bool matches = os.matched();
+        if (!oc.negated && !matches) {
+            std::cerr << "Fail: regexp " + oc.value + " not in " << stdxxx
+                      << "\n";
+            stream.print(std::cerr);
+            result = false;
+        } else if (oc.negated && matches) {
+            std::cerr << "Fail: regexp " + oc.value + " is in " << stdxxx
+                      << "\n";
+            stream.print(std::cerr);
+            result = false;
+        } else
+            result = true;
+    } else if (oc.type == oc_save) {
+        INV(!oc.negated);
         result = true;
     } else {
         UNREACHABLE;
-        result = false;
+        result = false;
+    }
+
+    return result;
+}
+
+static
+bool
+run_output_checks(output_stream& stream)
+{
+    bool ok = true;
+
+    for (std::list< output_state >::const_iterator iter =
+         stream.states().begin(); iter != stream.states().end(); iter++) {
+         ok &= run_output_check(*iter, stream);
+    }
+
+    return ok;
+}
+
+// Watches a file so that -r can repeat the command as soon as the file is
+// created, modified or removed instead of waiting for the whole interval.
+// The file's directory is watched with inotify(7) where available; other
+// systems fall back to looking at the file with stat(2) every few
+// milliseconds.
+class path_watcher {
+    std::string m_path;
+    std::string m_name;
+    int m_fd;
+
+    bool m_exists;
+    struct stat m_sb;
+
+    path_watcher(const path_watcher&);
+    path_watcher& operator=(const path_watcher&);
+
+    bool
+    stat_changed(void)
+        const
+    {
+        struct stat sb;
+        const bool exists = ::stat(m_path.c_str(), &sb) != -1;
+        if (exists != m_exists)
+            return true;
+        return exists && (sb.st_ino != m_sb.st_ino ||
+                          sb.st_size != m_sb.st_size ||
+                          sb.st_mtime != m_sb.st_mtime ||
+                          sb.st_ctime != m_sb.st_ctime);
+    }
+
+#if defined(HAVE_SYS_INOTIFY_H)
+    // Consumes the pending events and tells whether any concerns the file.
+    bool
+    read_events(void)
+    {
+        bool changed = false;
+        alignas(struct inotify_event) char buffer[4096];
+        ssize_t count;
+        while ((count = ::read(m_fd, buffer, sizeof(buffer))) > 0) {
+            for (const char* ptr = buffer; ptr < buffer + count; ) {
+                const struct inotify_event* event =
+                    reinterpret_cast< const struct inotify_event* >(ptr);
+                if ((event->mask & (IN_Q_OVERFLOW | IN_IGNORED)) ||
+                    (event->len > 0 && m_name == event->name))
+                    changed = true;
+                ptr += sizeof(struct inotify_event) + event->len;
+            }
+        }
+        return changed;
+    }
+#endif
+
+public:
+    explicit path_watcher(const std::string& path) :
+        m_path(path),
+        m_name(atf::fs::path(path).leaf_name()),
+        m_fd(-1),
+        m_exists(false)
+    {
+#if defined(HAVE_SYS_INOTIFY_H)
+        m_fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (m_fd != -1 && ::inotify_add_watch(m_fd,
+                atf::fs::path(path).branch_path().c_str(),
+                IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE |
+                IN_MODIFY | IN_MOVED_FROM | IN_MOVED_TO) == -1) {
+            ::close(m_fd);
+            m_fd = -1;
+        }
+#endif
+        snapshot();
+    }
+
+    ~path_watcher(void)
+    {
+        if (m_fd != -1)
+            ::close(m_fd);
+    }
+
+    // Records the current state of the file; changes are detected relative
+    // to the last snapshot.
+    void
+    snapshot(void)
+    {
+        m_exists = ::stat(m_path.c_str(), &m_sb) != -1;
+    }
+
+    // Waits for the file to change for at most the given time.  Returns
+    // whether it changed.
+    bool
+    wait(const useconds_t usecs)
+    {
+        const useconds_t deadline = get_monotonic_useconds() + usecs;
+        for (;;) {
+            const useconds_t now = get_monotonic_useconds();
+            if (now >= deadline)
+                return false;
+            const useconds_t remaining = deadline - now;
+
+            if (m_fd == -1) {
+                if (stat_changed())
+                    return true;
+                sleep_useconds(std::min(remaining,
+                                        10 * mseconds_in_useconds));
+                continue;
+            }
+
+#if defined(HAVE_SYS_INOTIFY_H)
+            if (read_events())
+                return true;
+
+            struct pollfd pfd;
+            pfd.fd = m_fd;
+            pfd.events = POLLIN;
+            ::poll(&pfd, 1, (remaining + mseconds_in_useconds - 1) /
+                   mseconds_in_useconds);
+#else
+            UNREACHABLE;
+#endif
+        }
+    }
+};
+
+// ------------------------------------------------------------------------
+// Check specifications.
+// ------------------------------------------------------------------------
+
+namespace {
+
+// A command together with the checks to apply to it, as given on the
+// command line or on a line of a batch file.
+struct check_spec {
+    bool rflag;
+    bool xflag;
+
+    useconds_t timo;
+    useconds_t min_interval;
+    useconds_t max_interval;
+    std::string watch;
+
+    std::vector< status_check > status_checks;
+    std::vector< output_check > stdout_checks;
+    std::vector< output_check > stderr_checks;
+
+    std::vector< std::string > argv;
+
+    check_spec(void) :
+        rflag(false),
+        xflag(false),
+        timo(0),
+        min_interval(0),
+        max_interval(0)
+    {
+    }
+};
+
+} // anonymous namespace
+
+static
+void
+add_spec_option(check_spec& spec, const int ch, const std::string& arg)
+{
+    switch (ch) {
+    case 's':
+        spec.status_checks.push_back(parse_status_check_arg(arg));
+        break;
+
+    case 'o':
+        spec.stdout_checks.push_back(parse_output_check_arg(arg));
+        break;
+
+    case 'e':
+        spec.stderr_checks.push_back(parse_output_check_arg(arg));
+        break;
+
+    case 'r':
+        spec.rflag = true;
+        parse_repeat_check_arg(arg, &spec.timo, &spec.min_interval,
+                               &spec.max_interval);
+        break;
+
+    case 'w':
+        spec.watch = arg;
+        break;
+
+    case 'x':
+        spec.xflag = true;
+        break;
+
+    default:
+        UNREACHABLE;
     }
+}
 
-    return result;
+// Decodes a $'...' string, as printed by the export -p builtin of bash(1),
+// starting at line[pos] and appends it to word.  On success, leaves pos at
+// the closing quote.
+static
+bool
+append_ansi_c_string(const std::string& line, std::string::size_type& pos,
+                     std::string& word)
+{
+    std::string::size_type i = pos + 2;
+    while (i < line.length() && line[i] != '\'') {
+        char c = line[i++];
+        if (c == '\\' && i < line.length()) {
+            c = line[i++];
+            switch (c) {
+            case 'a': c = '\a'; break;
+            case 'b': c = '\b'; break;
+            case 'e': case 'E': c = 033; break;
+            case 'f': c = '\f'; break;
+            case 'n': c = '\n'; break;
+            case 'r': c = '\r'; break;
+            case 't': c = '\t'; break;
+            case 'v': c = '\v'; break;
+            case 'x':
+                {
+                    int value = 0, count = 0;
+                    while (count < 2 && i < line.length() &&
+                           std::isxdigit(static_cast< unsigned char >(
+                               line[i]))) {
+                        const char d = line[i++];
+                        value = value * 16 + (std::isdigit(
+                            static_cast< unsigned char >(d)) ? d - '0' :
+                            std::tolower(static_cast< unsigned char >(d)) -
+                            'a' + 10);
+                        count++;
+                    }
+                    c = static_cast< char >(value);
+                    break;
+                }
+            default:
+                if (c >= '0' && c <= '7') {
+                    int value = c - '0', count = 1;
+                    while (count < 3 && i < line.length() &&
+                           line[i] >= '0' && line[i] <= '7') {
+                        value = value * 8 + (line[i++] - '0');
+                        count++;
+                    }
+                    c = static_cast< char >(value);
+                } else if (c != '\\' && c != '\'' && c != '"' && c != '?') {
+                    word += '\\';
+                }
+                break;
+            }
+        }
+        word += c;
+    }
+    if (i >= line.length())
+        return false;
+    pos = i;
+    return true;
 }
 
+// Splits a line of a batch file into words following the quoting rules of
+// sh(1).  No expansions are performed, and a word starting with '#' starts
+// a comment that extends to the end of the line.  Returns false if the line
+// ends within a quoted string.
 static
 bool
-run_output_checks(const std::vector< output_check >& checks,
-                  const atf::fs::path& path, const std::string& stdxxx)
+split_words(const std::string& line, std::vector< std::string >& words)
 {
-    bool ok = true;
+    std::string word;
+    bool in_word = false;
 
-    for (std::vector< output_check >::const_iterator iter = checks.begin();
-         iter != checks.end(); iter++) {
-         ok &= run_output_check(*iter, path, stdxxx);
+    for (std::string::size_type i = 0; i < line.length(); i++) {
+        const char ch = line[i];
+
+        if (ch == ' ' || ch == '\t') {
+            if (in_word) {
+                words.push_back(word);
+                word.clear();
+                in_word = false;
+            }
+        } else if (ch == '#' && !in_word) {
+            break;
+        } else if (ch == '\\') {
+            in_word = true;
+            if (++i < line.length())
+                word += line[i];
+        } else if (ch == '$' && i + 1 < line.length() &&
+                   line[i + 1] == '\'') {
+            in_word = true;
+            if (!append_ansi_c_string(line, i, word))
+                return false;
+        } else if (ch == '\'') {
+            in_word = true;
+            const std::string::size_type end = line.find('\'', i + 1);
+            if (end == std::string::npos)
+                return false;
+            word += line.substr(i + 1, end - i - 1);
+            i = end;
+        } else if (ch == '"') {
+            in_word = true;
+            for (i++; i < line.length() && line[i] != '"'; i++) {
+                if (line[i] == '\\' && i + 1 < line.length() &&
+                    std::strchr("$`\"\\", line[i + 1]) != NULL)
+                    i++;
+                word += line[i];
+            }
+            if (i == line.length())
+                return false;
+        } else {
+            in_word = true;
+            word += ch;
+        }
     }
+    if (in_word)
+        words.push_back(word);
 
-    return ok;
+    return true;
+}
+
+// Parses the words of a batch file line, which have the same syntax as the
+// arguments of atf-check, into a specification.
+static
+void
+parse_spec(const std::vector< std::string >& words, check_spec& spec)
+{
+    std::vector< std::string >::size_type i = 0;
+    while (i < words.size() && words[i].length() > 1 && words[i][0] == '-') {
+        const std::string& word = words[i++];
+        if (word == "--")
+            break;
+
+        const char ch = word[1];
+        if (ch == 'x' && word.length() == 2) {
+            add_spec_option(spec, ch, "");
+        } else if (std::strchr("eorsw", ch) != NULL) {
+            if (word.length() > 2)
+                add_spec_option(spec, ch, word.substr(2));
+            else if (i < words.size())
+                add_spec_option(spec, ch, words[i++]);
+            else
+                throw atf::application::usage_error("Option -%c requires an "
+                                                    "argument", ch);
+        } else
+            throw atf::application::usage_error("Unknown option `%s'",
+                                                word.c_str());
+    }
+
+    spec.argv.assign(words.begin() + i, words.end());
+}
+
+static
+int
+run_spec(check_spec& spec)
+{
+    if (spec.argv.empty())
+        throw atf::application::usage_error("No command specified");
+
+    int status = EXIT_FAILURE;
+
+    if (spec.status_checks.empty()) {
+        spec.status_checks.push_back(status_check(sc_exit, false,
+            EXIT_SUCCESS, false));
+    } else if (spec.status_checks.size() > 1) {
+        // TODO: Remove this restriction.
+        throw atf::application::usage_error("Cannot specify -s more than once");
+    }
+
+    if (!spec.watch.empty() && !spec.rflag)
+        throw atf::application::usage_error("-w can only be used together "
+                                            "with -r");
+
+    if (spec.stdout_checks.empty())
+        spec.stdout_checks.push_back(output_check(oc_empty, false, ""));
+    if (spec.stderr_checks.empty())
+        spec.stderr_checks.push_back(output_check(oc_empty, false, ""));
+
+    std::list< output_checker > stdout_checkers;
+    for (std::vector< output_check >::const_iterator iter =
+         spec.stdout_checks.begin(); iter != spec.stdout_checks.end(); iter++)
+        stdout_checkers.emplace_back(*iter);
+    std::list< output_checker > stderr_checkers;
+    for (std::vector< output_check >::const_iterator iter =
+         spec.stderr_checks.begin(); iter != spec.stderr_checks.end(); iter++)
+        stderr_checkers.emplace_back(*iter);
+
+    std::unique_ptr< path_watcher > watcher;
+    if (!spec.watch.empty())
+        watcher.reset(new path_watcher(spec.watch));
+    useconds_t interval = spec.min_interval;
+
+    do {
+        if (watcher.get() != NULL)
+            watcher->snapshot();
+
+        output_stream out("stdout", stdout_checkers);
+        output_stream err("stderr", stderr_checkers);
+        std::unique_ptr< exec_result > r =
+            spec.xflag ? execute_with_shell(spec.argv, out, err) :
+                         execute(spec.argv, out, err);
+
+        if ((run_status_checks(spec.status_checks, *r) == false) ||
+            (run_output_checks(err) == false) ||
+            (run_output_checks(out) == false))
+            status = EXIT_FAILURE;
+        else
+            status = EXIT_SUCCESS;
+
+        if (spec.rflag && status == EXIT_FAILURE) {
+            const useconds_t now = get_monotonic_useconds();
+            if (now >= spec.timo)
+                break;
+            const useconds_t delay = std::min(interval, spec.timo - now);
+
+            // Back off exponentially while nothing happens, but go back to
+            // quick polling once the watched file changes.
+            if (watcher.get() != NULL && watcher->wait(delay))
+                interval = spec.min_interval;
+            else {
+                if (watcher.get() == NULL)
+                    sleep_useconds(delay);
+                interval = next_interval(interval, spec.max_interval);
+            }
+        }
+    } while (spec.rflag && status == EXIT_FAILURE);
+
+    return status;
+}
+
+// Tells whether a line of a batch file ends in an unescaped backslash.
+static
+bool
+continues(const std::string& line)
+{
+    std::string::size_type count = 0;
+    while (count < line.length() && line[line.length() - 1 - count] == '\\')
+        count++;
+    return count % 2 == 1;
+}
+
+// Runs the checks of a batch file, one per line, in order.  Lines ending in
+// a backslash continue on the next line.  Stops at the first check that
+// fails so that later checks can rely on the earlier ones.
+static
+int
+run_batch(std::istream& is)
+{
+    std::string line;
+    std::size_t lineno = 0;
+
+    while (std::getline(is, line)) {
+        const std::size_t first = ++lineno;
+
+        std::string next;
+        while (continues(line) && std::getline(is, next)) {
+            line.erase(line.length() - 1);
+            line += next;
+            lineno++;
+        }
+
+        check_spec spec;
+        try {
+            std::vector< std::string > words;
+            if (!split_words(line, words))
+                throw atf::application::usage_error("Unterminated quote");
+            if (words.empty())
+                continue;
+            parse_spec(words, spec);
+            if (run_spec(spec) != EXIT_SUCCESS) {
+                std::cerr << "Fail: check at line " << first << " failed\n";
+                return EXIT_FAILURE;
+            }
+        } catch (const atf::application::usage_error& e) {
+            throw atf::application::usage_error("Line %zu: %s", first,
+                                                e.what());
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+// Opens one of the FIFOs of the server.  Opening them for both reading and
+// writing keeps the server from blocking until the client opens its end and
+// from seeing the end of the input whenever the client closes it.
+static
+int
+open_fifo(const std::string& path)
+{
+    const int fd = ::open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd == -1)
+        throw atf::system_error("atf_check", "Cannot open " + path, errno);
+    return fd;
+}
+
+// Waits until a FIFO of the server is ready for the given events.  Returns
+// false if the client exited in the meantime, which the server notices
+// because the alive FIFO reaches its end once the client, the only process
+// that keeps it open for writing, goes away.
+static
+bool
+wait_fifo(const int fd, const short events, const int alive)
+{
+    struct pollfd pfd[2];
+    pfd[0].fd = fd;
+    pfd[0].events = events;
+    pfd[1].fd = alive;
+    pfd[1].events = POLLIN;
+    for (;;) {
+        if (::poll(pfd, 2, -1) == -1) {
+            if (errno == EINTR)
+                continue;
+            throw atf::system_error("atf_check", "poll(2) failed", errno);
+        }
+
+        if (pfd[1].revents != 0) {
+            // Nothing is supposed to be written to the alive FIFO, but
+            // discard anything that is so that it does not keep us busy.
+            char buf[512];
+            const ssize_t n = ::read(alive, buf, sizeof(buf));
+            if (n == 0)
+                return false;
+            else if (n == -1 && errno != EINTR && errno != EAGAIN)
+                throw atf::system_error("atf_check", "read(2) failed",
+                                        errno);
+        }
+        if (pfd[0].revents != 0)
+            return true;
+    }
+}
+
+// Reads the next line of the requests FIFO, without its newline character.
+// Input read past the end of the line is kept in buffer for the next call.
+// Returns false if the client exited before sending a whole line.
+static
+bool
+read_request_line(const int fd, const int alive, std::string& buffer,
+                  std::string& line)
+{
+    std::string::size_type eol;
+    while ((eol = buffer.find('\n')) == std::string::npos) {
+        if (!wait_fifo(fd, POLLIN, alive))
+            return false;
+
+        char buf[4096];
+        const ssize_t n = ::read(fd, buf, sizeof(buf));
+        if (n == -1) {
+            if (errno == EINTR || errno == EAGAIN)
+                continue;
+            throw atf::system_error("atf_check", "read(2) failed", errno);
+        }
+        buffer.append(buf, n);
+    }
+    line = buffer.substr(0, eol);
+    buffer.erase(0, eol + 1);
+    return true;
+}
+
+// Writes a reply to the replies FIFO.  Returns false if the client exited
+// before reading all of it.
+static
+bool
+write_reply(const int fd, const int alive, const std::string& reply)
+{
+    std::string::size_type pos = 0;
+    while (pos < reply.length()) {
+        if (!wait_fifo(fd, POLLOUT, alive))
+            return false;
+
+        const ssize_t n = ::write(fd, reply.data() + pos,
+                                  reply.length() - pos);
+        if (n == -1) {
+            if (errno == EINTR || errno == EAGAIN)
+                continue;
+            throw atf::system_error("atf_check", "write(2) failed", errno);
+        }
+        pos += n;
+    }
+    return true;
+}
+
+// Sends the text printed while serving a request back to the client, one
+// line at a time, each prefixed by the given tag.
+static
+void
+send_lines(std::ostream& replies, const char tag, const std::string& text)
+{
+    std::string::size_type pos = 0;
+    while (pos < text.length()) {
+        std::string::size_type eol = text.find('\n', pos);
+        if (eol == std::string::npos)
+            eol = text.length();
+        replies << tag << ' ' << text.substr(pos, eol - pos) << '\n';
+        pos = eol + 1;
+    }
+}
+
+// Runs the check of a server request in the given directory, umask and
+// environment, capturing everything it prints.
+static
+int
+serve_run(const std::vector< std::string >& words, const std::string& dir,
+          const mode_t mask, std::vector< std::string >& env,
+          std::ostream& out, std::ostream& err)
+{
+    std::vector< char* > envp;
+    for (std::vector< std::string >::iterator iter = env.begin();
+         iter != env.end(); iter++)
+        envp.push_back(&(*iter)[0]);
+    envp.push_back(NULL);
+    char** old_environ = environ;
+    environ = &envp[0];
+    ::umask(mask);
+
+    std::streambuf* old_out = std::cout.rdbuf(out.rdbuf());
+    std::streambuf* old_err = std::cerr.rdbuf(err.rdbuf());
+
+    int status = EXIT_FAILURE;
+    try {
+        if (!dir.empty() && ::chdir(dir.c_str()) == -1)
+            throw std::runtime_error("Cannot enter directory " + dir + ": " +
+                                     std::strerror(errno));
+
+        check_spec spec;
+        parse_spec(words, spec);
+        status = run_spec(spec);
+    } catch (const std::exception& e) {
+        err << "atf-check: ERROR: " << e.what() << "\n";
+    }
+
+    std::cout.rdbuf(old_out);
+    std::cerr.rdbuf(old_err);
+    environ = old_environ;
+    return status;
+}
+
+// Serves the requests of a client until it exits, then removes the FIFOs,
+// the PID file and their directory.  Writes to ready once the FIFOs are
+// open so that the process that started the server can return, and stops
+// printing diagnostics to the stderr of the client from then on.
+static
+int
+serve(const std::string& dir, const int ready)
+{
+    const int requests = open_fifo(dir + "/requests");
+    const int replies = open_fifo(dir + "/replies");
+    const int alive = ::open((dir + "/alive").c_str(),
+                             O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (alive == -1)
+        throw atf::system_error("atf_check", "Cannot open " + dir + "/alive",
+                                errno);
+
+    {
+        std::ofstream pidfile((dir + "/pid").c_str());
+        if (!(pidfile << ::getpid() << "\n"))
+            throw std::runtime_error("Cannot create " + dir + "/pid");
+    }
+    if (::write(ready, "", 1) != 1)
+        throw atf::system_error("atf_check", "write(2) failed", errno);
+    ::close(ready);
+
+    const int null = ::open("/dev/null", O_WRONLY);
+    if (null != -1) {
+        ::dup2(null, STDERR_FILENO);
+        ::close(null);
+    }
+
+    std::string cwd;
+    const mode_t default_mask = ::umask(0);
+    ::umask(default_mask);
+    mode_t mask = default_mask;
+    std::vector< std::string > env;
+
+    std::string buffer, line;
+    while (read_request_line(requests, alive, buffer, line)) {
+        // Quoted values may span multiple lines.
+        std::vector< std::string > words;
+        std::string next;
+        bool complete;
+        while (!(complete = split_words(line, words)) &&
+               read_request_line(requests, alive, buffer, next)) {
+            words.clear();
+            line += "\n" + next;
+        }
+        if (!complete)
+            break;
+        if (words.empty())
+            continue;
+
+        if (words[0] == "cd" && words.size() == 2) {
+            cwd = words[1];
+        } else if (words[0] == "umask" && words.size() == 2) {
+            mask = std::strtol(words[1].c_str(), NULL, 8) & 0777;
+        } else if (words[0] == "export" || words[0] == "declare") {
+            // Exported variables without a value are not in the environment.
+            if (words.back().find('=') != std::string::npos)
+                env.push_back(words.back());
+        } else if (words[0] == "run") {
+            std::ostringstream out, err, reply;
+            const int status = serve_run(
+                std::vector< std::string >(words.begin() + 1, words.end()),
+                cwd, mask, env, out, err);
+            send_lines(reply, '1', out.str());
+            send_lines(reply, '2', err.str());
+            reply << "exit " << status << "\n";
+            if (!write_reply(replies, alive, reply.str()))
+                break;
+
+            cwd.clear();
+            mask = default_mask;
+            env.clear();
+        } else {
+            std::cerr << "atf-check: WARNING: Ignoring unknown request `"
+                      << line << "'\n";
+        }
+    }
+
+    ::close(requests);
+    ::close(replies);
+    ::close(alive);
+    ::unlink((dir + "/requests").c_str());
+    ::unlink((dir + "/replies").c_str());
+    ::unlink((dir + "/alive").c_str());
+    ::unlink((dir + "/pid").c_str());
+    ::rmdir(dir.c_str());
+    return EXIT_SUCCESS;
+}
+
+// Serves check requests sent by a client, usually libatf-sh, through the
+// requests and replies FIFOs in the given directory.  A request consists of
+// the following lines, quoted like those of a batch file:
+//
+//     cd <directory>
+//     umask <octal mask>
+//     export <name>=<value>    (one per variable, as printed by export -p)
+//     run <atf-check arguments>
+//
+// Only the run line is mandatory.  Each request is answered with the lines
+// printed to stdout and stderr, prefixed by "1 " and "2 " respectively, and
+// a final "exit <status>" line.
+//
+// The client opens the alive FIFO in the same directory for writing before
+// starting the server, which must not inherit that descriptor, and keeps it
+// open for as long as it needs the server.  The server detaches from the
+// client once the FIFOs are open, writing its PID to the pid file in the
+// same directory, so the client can start it synchronously and fall back to
+// running the checks by itself if it fails.  The server terminates once the
+// alive FIFO has no writers left, which happens when the client exits.
+static
+int
+run_server(const std::string& dir)
+{
+    int ready[2];
+    if (::pipe(ready) == -1)
+        throw atf::system_error("atf_check", "pipe(2) failed", errno);
+
+    const pid_t pid = ::fork();
+    if (pid == -1) {
+        throw atf::system_error("atf_check", "fork(2) failed", errno);
+    } else if (pid == 0) {
+        ::close(ready[0]);
+        return serve(dir, ready[1]);
+    }
+
+    ::close(ready[1]);
+    char ch;
+    ssize_t n;
+    while ((n = ::read(ready[0], &ch, 1)) == -1 && errno == EINTR)
+        continue;
+    ::close(ready[0]);
+    if (n == 1)
+        return EXIT_SUCCESS;
+
+    int status;
+    while (::waitpid(pid, &status, 0) == -1 && errno == EINTR)
+        continue;
+    return EXIT_FAILURE;
 }
 
 // ------------------------------------------------------------------------
@@ -794,21 +2163,13 @@ run_output_checks(const std::vector< output_check >& checks,
 namespace {
 
 class atf_check : public atf::application::app {
-    bool m_rflag;
-    bool m_xflag;
-
-    useconds_t m_timo;
-    useconds_t m_interval;
-
-    std::vector< status_check > m_status_checks;
-    std::vector< output_check > m_stdout_checks;
-    std::vector< output_check > m_stderr_checks;
+    check_spec m_spec;
+    bool m_spec_given;
+    std::string m_batch;
+    std::string m_server;
 
     static const char* m_description;
 
-    bool run_output_checks(const atf::check::check_result&,
-                           const std::string&) const;
-
     std::string specific_args(void) const;
     options_set specific_options(void) const;
     void process_option(int, const char*);
@@ -826,26 +2187,8 @@ const char* atf_check::m_description =
 
 atf_check::atf_check(void) :
     app(m_description, "atf-check(1)"),
-    m_rflag(false),
-    m_xflag(false)
-{
-}
-
-bool
-atf_check::run_output_checks(const atf::check::check_result& r,
-                             const std::string& stdxxx)
-    const
+    m_spec_given(false)
 {
-    if (stdxxx == "stdout") {
-        return ::run_output_checks(m_stdout_checks,
-            atf::fs::path(r.stdout_path()), "stdout");
-    } else if (stdxxx == "stderr") {
-        return ::run_output_checks(m_stderr_checks,
-            atf::fs::path(r.stderr_path()), "stderr");
-    } else {
-        UNREACHABLE;
-        return false;
-    }
 }
 
 std::string
@@ -862,6 +2205,10 @@ atf_check::specific_options(void)
     using atf::application::option;
     options_set opts;
 
+    opts.insert(option('b', "file", "Run the checks listed in file, one "
+                "per line; - reads them from stdin"));
+    opts.insert(option('S', "dir", "Serve the check requests received "
+                "through the FIFOs in dir"));
     opts.insert(option('s', "qual:value", "Handle status. Qualifier "
                 "must be one of: ignore exit:<num> signal:<name|num>"));
     opts.insert(option('o', "action:arg", "Handle stdout. Action must be "
@@ -870,8 +2217,10 @@ atf_check::specific_options(void)
     opts.insert(option('e', "action:arg", "Handle stderr. Action must be "
                 "one of: empty ignore file:<path> inline:<val> match:regexp "
                 "save:<path>"));
-    opts.insert(option('r', "timeout[:interval]", "Repeat failed check until "
-                "the timeout expires."));
+    opts.insert(option('r', "timeout[:interval[:max]]", "Repeat failed "
+                "check until the timeout expires."));
+    opts.insert(option('w', "path", "With -r, repeat the check as soon as "
+                "path changes."));
     opts.insert(option('x', "", "Execute command as a shell command"));
 
     return opts;
@@ -880,73 +2229,51 @@ atf_check::specific_options(void)
 void
 atf_check::process_option(int ch, const char* arg)
 {
-    switch (ch) {
-    case 's':
-        m_status_checks.push_back(parse_status_check_arg(arg));
-        break;
-
-    case 'o':
-        m_stdout_checks.push_back(parse_output_check_arg(arg));
-        break;
-
-    case 'e':
-        m_stderr_checks.push_back(parse_output_check_arg(arg));
-        break;
-
-    case 'r':
-        m_rflag = true;
-        parse_repeat_check_arg(arg, &m_timo, &m_interval);
-        break;
-
-    case 'x':
-        m_xflag = true;
-        break;
-
-    default:
-        UNREACHABLE;
+    if (ch == 'b') {
+        m_batch = arg;
+    } else if (ch == 'S') {
+        m_server = arg;
+    } else {
+        add_spec_option(m_spec, ch, arg != NULL ? arg : "");
+        m_spec_given = true;
     }
 }
 
 int
 atf_check::main(void)
 {
-    if (m_argc < 1)
-        throw atf::application::usage_error("No command specified");
-
-    int status = EXIT_FAILURE;
-
-    if (m_status_checks.empty()) {
-        m_status_checks.push_back(status_check(sc_exit, false, EXIT_SUCCESS,
-            false));
-    } else if (m_status_checks.size() > 1) {
-        // TODO: Remove this restriction.
-        throw atf::application::usage_error("Cannot specify -s more than once");
+    if (!m_server.empty()) {
+        if (m_argc > 0 || m_spec_given || !m_batch.empty())
+            throw atf::application::usage_error("-S cannot be combined with "
+                                                "other checks");
+        return run_server(m_server);
     }
 
-    if (m_stdout_checks.empty())
-        m_stdout_checks.push_back(output_check(oc_empty, false, ""));
-    if (m_stderr_checks.empty())
-        m_stderr_checks.push_back(output_check(oc_empty, false, ""));
-
-    do {
-        std::unique_ptr< atf::check::check_result > r =
-            m_xflag ? execute_with_shell(m_argv) : execute(m_argv);
+    if (!m_batch.empty()) {
+        if (m_argc > 0 || m_spec_given)
+            throw atf::application::usage_error("-b cannot be combined with "
+                                                "other checks");
+
+        if (m_batch == "-") {
+            // Read the whole batch first so that the commands do not
+            // consume it.
+            std::stringstream ss;
+            ss << std::cin.rdbuf();
+            return run_batch(ss);
+        }
 
-        if ((run_status_checks(m_status_checks, *r) == false) ||
-            (run_output_checks(*r, "stderr") == false) ||
-            (run_output_checks(*r, "stdout") == false))
-            status = EXIT_FAILURE;
-        else
-            status = EXIT_SUCCESS;
+        std::ifstream is(m_batch.c_str());
+        if (!is)
+            throw std::runtime_error("Cannot open batch file " + m_batch);
+        return run_batch(is);
+    }
 
-        if (m_rflag && status == EXIT_FAILURE) {
-            if (timo_expired(m_timo))
-                break;
-            usleep(m_interval);
-        }
-    } while (m_rflag && status == EXIT_FAILURE);
+    if (m_argc < 1)
+        throw atf::application::usage_error("No command specified");
 
-    return status;
+    for (int i = 0; i < m_argc; i++)
+        m_spec.argv.push_back(m_argv[i]);
+    return run_spec(m_spec);
 }
 
 int
@@ -238,6 +238,35 @@ oflag_save_body()
     cmp -s out exp || atf_fail "Saved output does not match expected results"
 }
 
+atf_test_case oflag_large
+oflag_large_head()
+{
+    atf_set "descr" "Tests for the -o option on outputs larger than what" \
+            "atf-check keeps in memory"
+}
+oflag_large_body()
+{
+    large="yes foo | head -n 2000000"
+    eval "${large}" >golden
+
+    h_pass "${large}" -o file:golden
+    h_pass "${large}" -o match:^foo$ -o save:saved
+    cmp -s saved golden || atf_fail "Saved output does not match golden"
+
+    h_pass "${large}; echo end" -o match:^end$ -o not-match:^bar$
+    h_pass "${large}; printf e; printf nd" -o match:^end$
+    h_fail "${large}" -o match:^foo.$
+
+    echo foo >>golden
+    h_fail "${large}" -o file:golden
+    grep "First difference at byte 8000000" tmp >/dev/null || \
+        atf_fail "atf-check did not report where the outputs differ"
+
+    h_fail "${large}" -o match:bar
+    grep "more bytes not shown" tmp >/dev/null || \
+        atf_fail "atf-check did not truncate the output in its report"
+}
+
 atf_test_case oflag_multiple
 oflag_multiple_head()
 {
@@ -387,21 +416,337 @@ stdin_body()
         atf_fail "atf-check does not seem to respect stdin"
 }
 
-atf_test_case invalid_umask
-invalid_umask_head()
+atf_test_case background_child
+background_child_head()
+{
+    atf_set "descr" "Tests that atf-check returns once the command exits," \
+            "even if a process it left in the background holds its output"
+}
+background_child_body()
+{
+    start=$(date +%s)
+    ${Atf_Check} -s exit:0 -o inline:"started\n" -e empty \
+        -x 'sleep 30 & echo ${!} >pid; echo started' || \
+        atf_fail "atf-check failed"
+    end=$(date +%s)
+    kill "$(cat pid)" 2>/dev/null
+    [ $((end - start)) -lt 10 ] || \
+        atf_fail "atf-check waited for the background process to exit"
+}
+
+atf_test_case rflag_checkers
+rflag_checkers_head()
+{
+    atf_set "descr" "Tests that -r prepares the output checks only once" \
+            "and reuses them when repeating the command"
+}
+rflag_checkers_body()
+{
+    cat >script.sh <<EOF
+#! ${Atf_Shell}
+rm -f golden
+if [ -f marker ]; then
+    echo foo
+else
+    touch marker
+    echo bar
+fi
+EOF
+    chmod +x script.sh
+
+    echo foo >golden
+    atf_check -s eq:0 -o ignore -e ignore ${Atf_Check} -r 5:10 \
+        -o file:golden -o inline:"foo\n" -o match:"^fo+$" ./script.sh
+    test -f marker || atf_fail "The command was not repeated"
+}
+
+atf_test_case rflag_backoff
+rflag_backoff_head()
+{
+    atf_set "descr" "Tests that -r backs off exponentially when no" \
+            "interval is given"
+}
+rflag_backoff_body()
+{
+    atf_check -s eq:1 -o ignore -e ignore ${Atf_Check} -r 2 \
+        -x 'echo run >>runs; false'
+    count=$(wc -l <runs)
+    [ ${count} -ge 3 ] || atf_fail "Ran only ${count} times"
+    [ ${count} -le 15 ] || atf_fail "Ran ${count} times; no backoff?"
+}
+
+atf_test_case wflag
+wflag_head()
+{
+    atf_set "descr" "Tests that -w repeats the command as soon as the" \
+            "watched file changes"
+}
+wflag_body()
+{
+    ( sleep 1; touch flag; sleep 5; touch late ) &
+    atf_check -s eq:0 -o ignore -e ignore ${Atf_Check} -r 10:60000 -w flag \
+        test -f flag -a ! -f late
+    wait
+}
+
+atf_test_case rflag_usage_errors
+rflag_usage_errors_head()
 {
-    atf_set "descr" "Tests for a correct error condition if the umask is" \
-            "too restrictive"
+    atf_set "descr" "Tests the usage errors of -r and -w"
 }
-invalid_umask_body()
+rflag_usage_errors_body()
+{
+    atf_check -s eq:1 -o empty -e match:"-w can only be used together" \
+        ${Atf_Check} -w flag true
+    atf_check -s eq:1 -o empty -e match:"must not be smaller" \
+        ${Atf_Check} -r 1:50:10 true
+    atf_check -s eq:1 -o empty -e match:"interval must be a number" \
+        ${Atf_Check} -r 1:50:foo true
+}
+
+atf_test_case bflag
+bflag_head()
+{
+    atf_set "descr" "Tests that -b runs all the checks in a batch"
+}
+bflag_body()
+{
+    echo foo >golden
+    cat >batch <<'EOF'
+# A comment.
+test -f golden
+
+-o file:golden cat golden
+-o inline:"foo\n" echo foo  # Another comment.
+-o 'match:^a b$' -e empty -x 'echo "a b"'
+-s exit:1 \
+    false
+-o save:saved echo saved
+EOF
+    atf_check -s eq:0 -o match:"cat golden" -e empty ${Atf_Check} -b batch
+    atf_check -s eq:0 -o inline:"saved\n" -e empty cat saved
+
+    rm saved
+    atf_check -s eq:0 -o ignore -e empty ${Atf_Check} -b - <batch
+    test -f saved || atf_fail "Batch read from stdin was not run"
+}
+
+atf_test_case bflag_fail
+bflag_fail_head()
+{
+    atf_set "descr" "Tests that -b stops at the first failed check"
+}
+bflag_fail_body()
+{
+    cat >batch <<EOF
+true
+-o inline:"bar\n" echo foo
+touch not-reached
+EOF
+    atf_check -s eq:1 -o ignore -e save:stderr ${Atf_Check} -b batch
+    atf_check -s eq:0 -o ignore -e empty grep "^+foo$" stderr
+    atf_check -s eq:0 -o ignore -e empty \
+        grep "check at line 2 failed" stderr
+    test ! -f not-reached || atf_fail "Checks after a failure were run"
+}
+
+atf_test_case bflag_usage_errors
+bflag_usage_errors_head()
+{
+    atf_set "descr" "Tests the usage errors of -b"
+}
+bflag_usage_errors_body()
+{
+    atf_check -s eq:1 -o empty -e match:"cannot be combined" \
+        ${Atf_Check} -b - true
+    atf_check -s eq:1 -o empty -e match:"cannot be combined" \
+        ${Atf_Check} -o empty -b -
+    echo '-o inline:"foo' >batch
+    atf_check -s eq:1 -o empty -e match:"Line 1: Unterminated quote" \
+        ${Atf_Check} -b batch
+    printf 'true\n-o empty\n' >batch
+    atf_check -s eq:1 -o ignore -e match:"Line 2: No command specified" \
+        ${Atf_Check} -b batch
+    printf 'true\n-q true\n' >batch
+    atf_check -s eq:1 -o ignore -e match:"Line 2: Unknown option" \
+        ${Atf_Check} -b batch
+}
+
+atf_test_case sflag_server
+sflag_server_head()
+{
+    atf_set "descr" "Tests that -S serves the requests it receives" \
+            "through FIFOs"
+}
+sflag_server_body()
+{
+    mkdir fifos sub
+    mkfifo fifos/requests fifos/replies fifos/alive
+    exec 9<>fifos/alive
+    ${Atf_Check} -S fifos </dev/null >/dev/null 9>&- || \
+        atf_fail "atf-check -S failed to start"
+    test -f fifos/pid || atf_fail "atf-check -S did not record its PID"
+
+    cat >fifos/requests <<'EOF'
+cd sub
+umask 022
+export ATF_CHECK_VAR=$'a\tb'
+declare -x ATF_CHECK_OTHER="c \"d\""
+run -o 'inline:a\tb c "d"\n' -x 'echo "$ATF_CHECK_VAR $ATF_CHECK_OTHER"'
+run -o inline:foo\\n echo bar
+EOF
+    exits=0
+    while [ ${exits} -lt 2 ] && IFS= read -r line; do
+        echo "${line}" >>replies
+        case "${line}" in
+        exit*) exits=$((exits + 1)) ;;
+        esac
+    done <fifos/replies
+
+    cat >expout <<'EOF'
+1 Executing command [ echo bar ]
+2 Fail: stdout does not match expected value
+2 First difference at byte 0
+2 --- expected
+2 +++ stdout
+2 @@ -1 +1 @@
+2 -foo
+2 +bar
+exit 1
+EOF
+    atf_check -s eq:0 -o match:"^exit 0$" -e empty head -n 2 replies
+    atf_check -s eq:0 -o file:expout -e empty tail -n +3 replies
+}
+
+atf_test_case sflag_server_client_exit
+sflag_server_client_exit_head()
+{
+    atf_set "descr" "Tests that -S exits and removes its FIFOs once the" \
+            "process that holds the alive FIFO exits"
+}
+sflag_server_client_exit_body()
+{
+    mkdir fifos
+    mkfifo fifos/requests fifos/replies fifos/alive
+    ${Atf_Shell} -c "exec 9<>fifos/alive; ${Atf_Check} -S fifos 9>&-" \
+        </dev/null || atf_fail "atf-check -S failed to start"
+
+    i=0
+    while [ -d fifos ]; do
+        [ ${i} -lt 10 ] || atf_fail "atf-check -S outlived its client"
+        sleep 1
+        i=$((i + 1))
+    done
+}
+
+atf_test_case sflag_server_stderr
+sflag_server_stderr_head()
+{
+    atf_set "descr" "Tests that -S stops printing to the stderr of its" \
+            "client once it is ready"
+}
+sflag_server_stderr_body()
+{
+    mkdir fifos
+    mkfifo fifos/requests fifos/replies fifos/alive
+    exec 9<>fifos/alive
+    ${Atf_Check} -S fifos </dev/null >/dev/null 2>stderr 9>&- || \
+        atf_fail "atf-check -S failed to start"
+
+    printf 'bogus request\nrun true\n' >fifos/requests
+    atf_check -s eq:0 -o inline:"1 Executing command [ true ]\nexit 0\n" \
+        -e empty head -n 2 fifos/replies
+    atf_check -s eq:0 -o empty -e empty cat stderr
+}
+
+atf_test_case sflag_server_start_error
+sflag_server_start_error_head()
+{
+    atf_set "descr" "Tests that -S fails instead of detaching if it" \
+            "cannot serve requests"
+}
+sflag_server_start_error_body()
+{
+    mkdir fifos
+    atf_check -s eq:1 -o empty -e match:"Cannot open fifos/requests" \
+        ${Atf_Check} -S fifos
+}
+
+atf_test_case builtin_diff
+builtin_diff_head()
+{
+    atf_set "descr" "Tests that mismatches are reported with a diff that" \
+            "does not need diff(1) in the path"
+}
+builtin_diff_body()
+{
+    printf '#! %s\necho bar\n' "${Atf_Shell}" >script.sh
+    chmod +x script.sh
+    echo foo >golden
+
+    for check in inline:"foo\n" file:golden empty; do
+        atf_check -s eq:1 -o ignore -e save:stderr \
+            env PATH=/nonexistent ${Atf_Check} -o "${check}" ./script.sh
+        atf_check -s eq:0 -o ignore -e empty grep "^+bar$" stderr
+        atf_check -s eq:0 -o ignore -e empty grep "^+++ stdout$" stderr
+        if [ "${check}" != empty ]; then
+            atf_check -s eq:0 -o ignore -e empty grep "^-foo$" stderr
+        fi
+    done
+}
+
+atf_test_case first_difference
+first_difference_head()
+{
+    atf_set "descr" "Tests that file and inline mismatches report the" \
+            "offset of the first differing byte"
+}
+first_difference_body()
+{
+    printf 'abcdefgh\n' >golden
+    for check in inline:"abcdXfgh\n" file:golden; do
+        atf_check -s eq:1 -o ignore -e save:stderr \
+            ${Atf_Check} -o "${check}" echo abcdYfgh
+        atf_check -s eq:0 -o ignore -e empty \
+            grep "^First difference at byte 4$" stderr
+    done
+    atf_check -s eq:1 -o ignore -e match:"First difference at byte 8" \
+        ${Atf_Check} -o file:golden echo abcdefgh more
+    atf_check -s eq:0 -o ignore -e empty ${Atf_Check} -o file:golden \
+        echo abcdefgh
+}
+
+atf_test_case capture_in_memory
+capture_in_memory_head()
+{
+    atf_set "descr" "Tests that the output of the command is checked" \
+            "without creating temporary files"
+}
+capture_in_memory_body()
+{
+    mkdir tmp
+    atf_check -s eq:0 -o ignore -e empty env TMPDIR="$(pwd)/tmp" \
+        ${Atf_Check} -o inline:"foo\n" -e match:bar \
+        -x 'echo foo; echo bar 1>&2'
+    atf_check -s eq:0 -o ignore -e empty env TMPDIR="$(pwd)/missing" \
+        ${Atf_Check} -o save:saved -e empty echo foo
+    atf_check -s eq:0 -o inline:"foo\n" -e empty cat saved
+    test -z "$(ls tmp)" || atf_fail "atf-check left files in TMPDIR"
+}
+
+atf_test_case restrictive_umask
+restrictive_umask_head()
+{
+    atf_set "descr" "Tests that a restrictive umask does not prevent the" \
+            "output of the command from being captured"
+}
+restrictive_umask_body()
 {
     umask 0222
-    ${Atf_Check} false 2>stderr && \
-        atf_fail "atf-check returned 0 but it should have failed"
-    cat stderr
-    grep 'temporary.*current umask.*0222' stderr >/dev/null || \
-        atf_fail "atf-check did not report an error related to the" \
-                 "current umask"
+    atf_check -s eq:0 -o inline:"Executing command [ echo foo ]\n" -e empty \
+        ${Atf_Check} -o inline:"foo\n" echo foo
+    atf_check -s eq:1 -o ignore -e match:"^\\+bar" \
+        ${Atf_Check} -o inline:"foo\n" echo bar
 }
 
 atf_init_test_cases()
@@ -419,6 +764,7 @@ atf_init_test_cases()
     atf_add_test_case oflag_inline
     atf_add_test_case oflag_match
     atf_add_test_case oflag_save
+    atf_add_test_case oflag_large
     atf_add_test_case oflag_multiple
     atf_add_test_case oflag_negated
 
@@ -432,8 +778,23 @@ atf_init_test_cases()
     atf_add_test_case eflag_negated
 
     atf_add_test_case stdin
-
-    atf_add_test_case invalid_umask
+    atf_add_test_case background_child
+
+    atf_add_test_case rflag_checkers
+    atf_add_test_case rflag_backoff
+    atf_add_test_case wflag
+    atf_add_test_case rflag_usage_errors
+    atf_add_test_case bflag
+    atf_add_test_case bflag_fail
+    atf_add_test_case bflag_usage_errors
+    atf_add_test_case sflag_server
+    atf_add_test_case sflag_server_client_exit
+    atf_add_test_case sflag_server_stderr
+    atf_add_test_case sflag_server_start_error
+    atf_add_test_case builtin_diff
+    atf_add_test_case first_difference
+    atf_add_test_case capture_in_memory
+    atf_add_test_case restrictive_umask
 }
 
 # vim: syntax=sh:expandtab:shiftwidth=4:softtabstop=4
@@ -140,6 +140,87 @@ null_stderr_body()
         atf_fail "atf_check does not print stderr's contents"
 }
 
+atf_test_case builtin
+builtin_head()
+{
+    atf_set "descr" "Verifies that atf_check evaluates simple checks" \
+                    "within the shell if atf.check_builtin is set"
+}
+builtin_body()
+{
+    h="$(atf_get_srcdir)/misc_helpers -s $(atf_get_srcdir)"
+
+    atf_check -s eq:0 -o match:"Executing command.*cd dir && pwd" \
+              -e ignore -x "${h} -v atf.check_builtin=true atf_check_builtin"
+    atf_check -s eq:1 -o ignore -e ignore -x "${h} atf_check_builtin"
+    rm -rf dir
+
+    atf_check -s eq:1 -o save:stdout -e save:stderr -x \
+              "${h} -v atf.check_builtin=true atf_check_builtin_fail"
+    grep 'Executing command.*echo bar; exit 2' stdout >/dev/null || \
+        atf_fail "atf_check does not print an informative message"
+    grep 'incorrect exit status: 2, expected: 0' stderr >/dev/null || \
+        atf_fail "atf_check does not report the exit status"
+    grep 'EXIT trap ran' stdout >/dev/null || \
+        atf_fail "atf_check replaced the EXIT trap of the test case"
+
+    atf_check -s eq:1 -o ignore -e match:"Cannot specify -s more than once" \
+              -x "${h} -v atf.check_builtin=true atf_check_builtin_sflags"
+
+    for tc in atf_check_null_stdout atf_check_null_stderr; do
+        atf_check -s eq:1 -o match:"Executing command.*These.*contents" \
+                  -e match:"not empty" -e match:"These are the contents" \
+                  -x "${h} -v atf.check_builtin=true ${tc}"
+    done
+
+    atf_check -s eq:1 -o ignore -e match:"^-foo" -e match:"^\+bar" -x \
+              "${h} -v atf.check_builtin=true atf_check_expout_mismatch"
+
+    for dir in .atf_check.*; do
+        [ ! -e "${dir}" ] || atf_fail "atf_check leaked ${dir}"
+    done
+}
+
+atf_test_case coprocess
+coprocess_head()
+{
+    atf_set "descr" "Verifies that atf_check sends its checks to an" \
+                    "atf-check coprocess if atf.check_server is set"
+}
+coprocess_body()
+{
+    h="$(atf_get_srcdir)/misc_helpers -s $(atf_get_srcdir)"
+
+    atf_check -s eq:0 -o save:stdout -e ignore -x \
+              "${h} -v atf.check_server=true atf_check_server"
+    pid=$(sed -n -e 's/^background: //p' stdout)
+    dir=$(sed -n -e 's/^coprocess: //p' stdout)
+    i=0
+    while [ -d "${dir}" ]; do
+        if [ ${i} -ge 10 ]; then
+            kill "${pid}"
+            atf_fail "The atf-check coprocess outlived the test case"
+        fi
+        sleep 1
+        i=$((i + 1))
+    done
+    kill "${pid}"
+    atf_check -s eq:1 -o match:"coprocess is not running" -e ignore -x \
+              "${h} atf_check_server"
+
+    atf_check -s eq:0 -o ignore -e ignore -x \
+              "${h} -v atf.check_server=true atf_check_server_fallback"
+
+    atf_check -s eq:1 -o save:stdout -e save:stderr -x \
+              "${h} -v atf.check_server=true atf_check_expout_mismatch"
+    grep 'Executing command.*echo bar' stdout >/dev/null || \
+        atf_fail "atf_check does not print an informative message"
+    grep '^-foo' stderr >/dev/null || \
+        atf_fail "atf_check does not print the stdout's diff"
+    grep '^+bar' stderr >/dev/null || \
+        atf_fail "atf_check does not print the stdout's diff"
+}
+
 atf_test_case equal
 equal_head()
 {
@@ -214,6 +295,8 @@ atf_init_test_cases()
     atf_add_test_case experr_mismatch
     atf_add_test_case null_stdout
     atf_add_test_case null_stderr
+    atf_add_test_case builtin
+    atf_add_test_case coprocess
     atf_add_test_case equal
     atf_add_test_case flush_stdout_on_death
 }
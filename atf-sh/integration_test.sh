@@ -147,6 +147,44 @@ EOF
         "${ATF_SH}" -s ./custom-shell tp helper
 }
 
+atf_test_case generated_test_cases
+generated_test_cases_head()
+{
+    atf_set "descr" "Tests that test cases generated in a loop can be" \
+        "listed in order and looked up by name"
+}
+generated_test_cases_body()
+{
+    create_test_program tp <<EOF
+i=1
+while [ \${i} -le 300 ]; do
+    atf_test_case tc_\${i}
+    eval "tc_\${i}_body() { echo 'Running tc_\${i}'; }"
+    i=\$((i + 1))
+done
+
+atf_init_test_cases() {
+    i=1
+    while [ \${i} -le 300 ]; do
+        atf_add_test_case tc_\${i}
+        i=\$((i + 1))
+    done
+}
+EOF
+
+    atf_check -s eq:0 -o save:stdout -e empty ./tp -l
+    atf_check -s eq:0 -o inline:"tc_1\ntc_2\ntc_3\n" -e empty \
+        -x "sed -n -e 's/^ident: //p' stdout | head -n 3"
+    atf_check -s eq:0 -o match:"^ident: tc_300$" -e empty tail -n 1 stdout
+
+    atf_check -s eq:0 -o match:"Running tc_150" -o match:"passed" \
+        -e ignore ./tp tc_150
+    for name in tc_301 tc_ tc_1_2 "tc_1 tc_2" 'tc_1;tc_2' 'tc_1.x'; do
+        atf_check -s eq:1 -o empty \
+            -e match:"Unknown test case \`${name}'" ./tp "${name}"
+    done
+}
+
 atf_init_test_cases()
 {
     atf_add_test_case no_args
@@ -155,6 +193,7 @@ atf_init_test_cases()
     atf_add_test_case custom_shell__command_line
     atf_add_test_case custom_shell__shebang
     atf_add_test_case set_e
+    atf_add_test_case generated_test_cases
 }
 
 # vim: syntax=sh:expandtab:shiftwidth=4:softtabstop=4
@@ -95,6 +95,114 @@ atf_check_null_stderr_body()
     atf_check -s eq:0 -o empty -e empty -x 'echo "These are the contents" 1>&2'
 }
 
+atf_test_case atf_check_builtin
+atf_check_builtin_head()
+{
+    atf_set "descr" "Helper test case for the t_atf_check test program"
+}
+atf_check_builtin_body()
+{
+    # Any check that is not evaluated within the shell fails.
+    Atf_Check=false
+
+    atf_check true
+    atf_check -s exit:3 -x 'exit 3'
+    atf_check -s ignore -o ignore -e ignore -x 'echo foo; echo bar 1>&2; exit 7'
+    atf_check -s eq:0 -o inline:'a  b\n\\c\n' -e empty \
+        printf '%s\n%s\n' 'a  b' '\c'
+    atf_check -o inline:'no newline' printf 'no newline'
+    atf_check -o empty -e inline:"bar\n" -x 'echo bar 1>&2'
+    atf_check -s exit:1 -x false
+    OPTIND=5
+    atf_check -s exit:0 true
+    [ ${OPTIND} -eq 5 ] || atf_fail "atf_check clobbered OPTIND"
+
+    mkdir dir
+    atf_check -o inline:"$(pwd)/dir\n" -x 'cd dir && pwd'
+    atf_check -s exit:1 -x 'exit 1'
+    [ -d dir ] || atf_fail "The check did not run in a subshell"
+}
+
+atf_test_case atf_check_builtin_fail
+atf_check_builtin_fail_head()
+{
+    atf_set "descr" "Helper test case for the t_atf_check test program"
+}
+atf_check_builtin_fail_body()
+{
+    trap 'echo "EXIT trap ran"' EXIT
+    atf_check -s exit:0 -o inline:"foo\n" -e empty -x 'echo bar; exit 2'
+}
+
+atf_test_case atf_check_builtin_sflags
+atf_check_builtin_sflags_head()
+{
+    atf_set "descr" "Helper test case for the t_atf_check test program"
+}
+atf_check_builtin_sflags_body()
+{
+    atf_check -s exit:0 -s exit:1 -x false
+}
+
+atf_test_case atf_check_server
+atf_check_server_head()
+{
+    atf_set "descr" "Helper test case for the t_atf_check test program"
+}
+atf_check_server_body()
+{
+    # The coprocess only takes descriptor 9, to tell it when we are gone.
+    exec 8>fd8
+    mkdir dir
+    cd dir
+    echo "it's here" >file
+    atf_check -s eq:0 -o inline:"it's here\n" -e empty cat file
+    [ "${Check_Server}" = running ] || \
+        atf_fail "The atf-check coprocess is not running"
+
+    export ATF_CHECK_VAR='a "b" $c
+d'
+    atf_check -s eq:0 -o inline:'a "b" $c\nd\n' -e empty \
+        -x 'echo "${ATF_CHECK_VAR}"'
+
+    umask 027
+    atf_check -s eq:0 -o match:'027$' -e empty -x umask
+
+    atf_check -s eq:0 -o inline:"foo\n" -e inline:"bar\n" \
+        -x 'echo foo; echo bar 1>&2' >log 2>&1
+    grep 'Executing command' log >/dev/null || \
+        atf_fail "The output of atf_check was not redirected"
+
+    echo 8 >&8
+    atf_check -s eq:0 -o inline:"8\n" -e empty cat ../fd8
+
+    # A process left in the background without the descriptor of the
+    # coprocess must not keep it alive.
+    sleep 60 </dev/null >/dev/null 2>&1 9>&- &
+    echo "background: ${!}"
+    echo "coprocess: ${Check_Server_Dir}"
+}
+
+atf_test_case atf_check_server_fallback
+atf_check_server_fallback_head()
+{
+    atf_set "descr" "Helper test case for the t_atf_check test program"
+}
+atf_check_server_fallback_body()
+{
+    cat >atf-check <<EOF
+#! ${Atf_Shell}
+[ "\${1}" != -S ] || exit 1
+exec ${Atf_Check} "\${@}"
+EOF
+    chmod +x atf-check
+    Atf_Check="$(pwd)/atf-check"
+
+    atf_check -s eq:0 -o inline:"foo\n" -e empty echo foo
+    [ "${Check_Server}" != running ] || \
+        atf_fail "The atf-check coprocess is running"
+}
+
 atf_test_case atf_check_equal_ok
 atf_check_equal_ok_head()
 {
@@ -239,11 +347,14 @@ normalize_head()
     atf_set "descr" "Helper test case for the t_normalize test program"
     atf_set "a.b" "test value 1"
     atf_set "c-d" "test value 2"
+    atf_set "e.f-g.h" "test value 3"
 }
 normalize_body()
 {
     echo "a.b: $(atf_get a.b)"
     echo "c-d: $(atf_get c-d)"
+    echo "e.f-g.h: $(atf_get e.f-g.h)"
+    echo "i.j-k: $(atf_config_get i.j-k)"
 }
 
 # -------------------------------------------------------------------------
@@ -325,6 +436,11 @@ atf_init_test_cases()
     atf_add_test_case atf_check_experr_mismatch
     atf_add_test_case atf_check_null_stdout
     atf_add_test_case atf_check_null_stderr
+    atf_add_test_case atf_check_builtin
+    atf_add_test_case atf_check_builtin_fail
+    atf_add_test_case atf_check_builtin_sflags
+    atf_add_test_case atf_check_server
+    atf_add_test_case atf_check_server_fallback
     atf_add_test_case atf_check_equal_ok
     atf_add_test_case atf_check_equal_fail
     atf_add_test_case atf_check_equal_eval_ok
@@ -33,7 +33,9 @@ main_body()
 {
     h="$(atf_get_srcdir)/misc_helpers -s $(atf_get_srcdir)"
     atf_check -s eq:0 -o match:'a.b: test value 1' \
-        -o match:'c-d: test value 2' -e ignore ${h} normalize
+        -o match:'c-d: test value 2' -o match:'e.f-g.h: test value 3' \
+        -o match:'i.j-k: test value 4' -e ignore \
+        ${h} -v i.j-k="test value 4" normalize
 }
 
 atf_init_test_cases()
@@ -0,0 +1,98 @@
+// Copyright (c) 2026 The NetBSD Foundation, Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+// 1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+// CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+// INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+// IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+// IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+// IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+extern "C" {
+#include <sys/wait.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+}
+
+#include <cerrno>
+#include <cstdlib>
+#include <string>
+
+#include <atf-c++.hpp>
+
+// ------------------------------------------------------------------------
+// Auxiliary functions.
+// ------------------------------------------------------------------------
+
+namespace {
+
+// Runs the misc_helpers test program to list its test cases, which loads
+// the atf-sh library and the whole test program but runs nothing else.
+static
+void
+list_helpers(const std::string& srcdir)
+{
+    const std::string helpers = srcdir + "/misc_helpers";
+
+    const pid_t pid = ::fork();
+    ATF_REQUIRE(pid != -1);
+    if (pid == 0) {
+        const int fd = ::open("/dev/null", O_WRONLY);
+        if (fd != -1) {
+            ::dup2(fd, STDOUT_FILENO);
+            ::dup2(fd, STDERR_FILENO);
+        }
+        ::execl(helpers.c_str(), helpers.c_str(), "-s", srcdir.c_str(), "-l",
+                static_cast< char* >(NULL));
+        ::_exit(127);
+    }
+
+    int status;
+    while (::waitpid(pid, &status, 0) == -1)
+        ATF_REQUIRE_EQ(EINTR, errno);
+    ATF_REQUIRE(WIFEXITED(status));
+    ATF_REQUIRE_EQ(EXIT_SUCCESS, WEXITSTATUS(status));
+}
+
+} // anonymous namespace
+
+// ------------------------------------------------------------------------
+// Benchmarks.
+// ------------------------------------------------------------------------
+
+ATF_BENCH(startup);
+ATF_BENCH_HEAD(startup)
+{
+    set_md_var("descr", "Measures the startup of an atf-sh test program, "
+               "which sources the library and the test program");
+}
+ATF_BENCH_BODY(startup, iterations)
+{
+    for (size_t i = 0; i < iterations; i++)
+        list_helpers(get_config_var("srcdir"));
+}
+
+// ------------------------------------------------------------------------
+// Main.
+// ------------------------------------------------------------------------
+
+ATF_INIT_TEST_CASES(tcs)
+{
+    ATF_ADD_TEST_CASE(tcs, startup);
+}
@@ -0,0 +1,146 @@
+# Copyright (c) 2026 The NetBSD Foundation, Inc.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+# 1. Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+# 2. Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#
+# THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+# CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+# INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+# IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+# DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+# GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+# INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+# IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+# IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+atf_test_case run_many
+run_many_head()
+{
+    atf_set "descr" "Tests that -b runs several test cases from a single" \
+                    "invocation and stores their results separately"
+}
+run_many_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers c_helpers sh_helpers); do
+        cat >expout <<EOF
+result_pass: exit(0)
+result_fail: exit(1)
+result_skip: exit(0)
+EOF
+        atf_check -s eq:1 -o file:expout -e ignore "${h}" -s "${srcdir}" \
+            -b batch result_pass result_fail result_skip
+
+        atf_check -o inline:"passed\n" cat batch/result_pass/result
+        atf_check -o inline:"msg\n" cat batch/result_pass/stdout
+        atf_check -o inline:"failed: Failure reason\n" \
+            cat batch/result_fail/result
+        atf_check -o inline:"skipped: Skipped reason\n" \
+            cat batch/result_skip/result
+        test -d batch/result_pass/work || atf_fail "Work directory not created"
+        rm -rf batch
+    done
+}
+
+atf_test_case tclist
+tclist_head()
+{
+    atf_set "descr" "Tests that -f reads the test cases to run in batch" \
+                    "mode from a file"
+}
+tclist_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    cat >tclist <<EOF
+# Comments and blank lines are ignored.
+
+result_skip
+result_pass
+EOF
+    for h in $(get_helpers c_helpers sh_helpers); do
+        atf_check -s eq:0 -o inline:"result_skip: exit(0)\nresult_pass: exit(0)\n" \
+            -e ignore "${h}" -s "${srcdir}" -b batch -f tclist
+        atf_check -o inline:"passed\n" cat batch/result_pass/result
+        atf_check -o inline:"skipped: Skipped reason\n" \
+            cat batch/result_skip/result
+        rm -rf batch
+    done
+}
+
+atf_test_case cleanup_workdir
+cleanup_workdir_head()
+{
+    atf_set "descr" "Tests that the body and the cleanup of a test case" \
+                    "share the same work directory in batch mode"
+}
+cleanup_workdir_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers c_helpers sh_helpers); do
+        atf_check -s eq:0 -o ignore -e ignore "${h}" -s "${srcdir}" \
+            -v tmpfile=foo -v cleanup=no -b batch cleanup_pass
+        test -f batch/cleanup_pass/work/foo || atf_fail "Body did not run" \
+            "in the work directory"
+        atf_check -s eq:0 -o inline:"cleanup_pass:cleanup: exit(0)\n" \
+            -e ignore "${h}" -s "${srcdir}" -v tmpfile=foo -v cleanup=yes \
+            -b batch cleanup_pass:cleanup
+        test ! -f batch/cleanup_pass/work/foo || atf_fail "Cleanup did not" \
+            "run in the work directory"
+        rm -rf batch
+    done
+}
+
+atf_test_case unknown_tc
+unknown_tc_head()
+{
+    atf_set "descr" "Tests that the whole batch is rejected if any of the" \
+                    "test cases does not exist"
+}
+unknown_tc_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers c_helpers sh_helpers); do
+        atf_check -s eq:1 -o empty -e match:"Unknown test case .foo'" \
+            "${h}" -s "${srcdir}" -b batch result_pass foo
+        test ! -d batch/result_pass || atf_fail "Batch partially executed"
+    done
+}
+
+atf_test_case usage_errors
+usage_errors_head()
+{
+    atf_set "descr" "Tests the usage errors of batch mode"
+}
+usage_errors_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers c_helpers sh_helpers); do
+        atf_check -s eq:1 -o empty -e match:"at least one test case" \
+            "${h}" -s "${srcdir}" -b batch
+        atf_check -s eq:1 -o empty -e match:"-r together with -b" \
+            "${h}" -s "${srcdir}" -r resfile -b batch result_pass
+        atf_check -s eq:1 -o empty -e match:"-f can only be used" \
+            "${h}" -s "${srcdir}" -f tclist result_pass
+    done
+}
+
+atf_init_test_cases()
+{
+    atf_add_test_case run_many
+    atf_add_test_case tclist
+    atf_add_test_case cleanup_workdir
+    atf_add_test_case unknown_tc
+    atf_add_test_case usage_errors
+}
+
+# vim: syntax=sh:expandtab:shiftwidth=4:softtabstop=4
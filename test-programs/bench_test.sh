@@ -0,0 +1,98 @@
+# Copyright (c) 2026 The NetBSD Foundation, Inc.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+# 1. Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+# 2. Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#
+# THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+# CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+# INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+# IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+# DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+# GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+# INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+# IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+# IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+atf_test_case metadata
+metadata_head()
+{
+    atf_set "descr" "Tests that benchmarks are marked as such in the list" \
+                    "of test cases"
+}
+metadata_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers c_helpers cpp_helpers); do
+        atf_check -s eq:0 -o save:stdout -e empty "${h}" -s "${srcdir}" -l
+        sed -n '/^ident: bench_loop$/,/^$/p' stdout >bench_loop
+        atf_check -o match:"^X-bench: true$" \
+            -o match:"^descr: Helper benchmark" cat bench_loop
+        sed -n '/^ident: bench_no_head$/,/^$/p' stdout >bench_no_head
+        atf_check -o match:"^X-bench: true$" cat bench_no_head
+        sed -n '/^ident: result_pass$/,/^$/p' stdout >result_pass
+        atf_check -o not-match:"X-bench" cat result_pass
+    done
+}
+
+atf_test_case run
+run_head()
+{
+    atf_set "descr" "Tests that benchmarks report their calibrated results"
+}
+run_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers c_helpers cpp_helpers); do
+        for tc in bench_loop bench_no_head; do
+            atf_check -s eq:0 \
+                -o match:"^${tc}: [0-9]+ iterations, [0-9.]+ ns/op \+/- [0-9.]+$" \
+                -e ignore "${h}" -s "${srcdir}" -v atf.bench.time_ms=20 \
+                -r resfile "${tc}"
+            atf_check -o inline:"passed\n" cat resfile
+        done
+
+        atf_check -s eq:0 -o ignore -e ignore "${h}" -s "${srcdir}" \
+            -v atf.bench.time_ms=20 -v atf.usage=true -r resfile bench_loop
+        atf_check -o inline:"passed\n" cat resfile
+        atf_check \
+            -o match:"^bench: iterations=[0-9]+ ns/op=[0-9.]+ ci95=[0-9.]+$" \
+            -o match:"^usage: body " cat resfile.usage
+    done
+}
+
+atf_test_case fail
+fail_head()
+{
+    atf_set "descr" "Tests that benchmarks can fail like any other test case"
+}
+fail_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers c_helpers cpp_helpers); do
+        atf_check -s eq:1 -o empty -e ignore "${h}" -s "${srcdir}" \
+            -v fail=true -v atf.usage=true -r resfile bench_loop
+        atf_check -o match:"^failed: .*Failed on purpose$" cat resfile
+        test $(wc -l <resfile) -eq 1 || atf_fail "Unexpected results file"
+        atf_check -o not-match:"^bench:" -o match:"^usage: body " \
+            cat resfile.usage
+    done
+}
+
+atf_init_test_cases()
+{
+    atf_add_test_case metadata
+    atf_add_test_case run
+    atf_add_test_case fail
+}
+
+# vim: syntax=sh:expandtab:shiftwidth=4:softtabstop=4
@@ -64,6 +64,58 @@ touch(const char *path)
     close(fd);
 }
 
+/* Copies the X-perf.* configuration variables to the meta-data so that the
+ * callers can exercise different performance limits. */
+static
+void
+copy_perf_limits(atf_tc_t *tc)
+{
+    static const char *const names[] = { "X-perf.baseline", "X-perf.max_ms",
+        "X-perf.max_rss_kb", "X-perf.max_ns_per_op", NULL };
+    const char *const *name;
+
+    for (name = names; *name != NULL; name++)
+        if (atf_tc_has_config_var(tc, *name))
+            atf_tc_set_md_var(tc, *name, "%s",
+                              atf_tc_get_config_var(tc, *name));
+}
+
+/* ---------------------------------------------------------------------
+ * Helper tests for "t_bench".
+ * --------------------------------------------------------------------- */
+
+ATF_BENCH(bench_loop);
+ATF_BENCH_HEAD(bench_loop, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Helper benchmark for the t_bench test "
+                      "program");
+    copy_perf_limits(tc);
+}
+ATF_BENCH_BODY(bench_loop, tc, iterations)
+{
+    const long delay_us = atf_tc_get_config_var_as_long_wd(tc, "delay_us", 0);
+    volatile size_t sink = 0;
+    size_t i;
+
+    if (atf_tc_get_config_var_as_bool_wd(tc, "fail", false))
+        atf_tc_fail("Failed on purpose");
+    for (i = 0; i < iterations; i++) {
+        sink += i;
+        if (delay_us > 0)
+            usleep(delay_us);
+    }
+}
+
+ATF_BENCH_WITHOUT_HEAD(bench_no_head);
+ATF_BENCH_BODY(bench_no_head, tc, iterations)
+{
+    volatile size_t sink = 0;
+    size_t i;
+
+    for (i = 0; i < iterations; i++)
+        sink += i;
+}
+
 /* ---------------------------------------------------------------------
  * Helper tests for "t_cleanup".
  * --------------------------------------------------------------------- */
@@ -378,6 +430,35 @@ ATF_TC_BODY(metadata_no_head, tc)
 {
 }
 
+/* ---------------------------------------------------------------------
+ * Helper tests for "t_perf".
+ * --------------------------------------------------------------------- */
+
+ATF_TC(perf_limits);
+ATF_TC_HEAD(perf_limits, tc)
+{
+    atf_tc_set_md_var(tc, "descr", "Helper test case for the t_perf test "
+                      "program");
+    copy_perf_limits(tc);
+}
+ATF_TC_BODY(perf_limits, tc)
+{
+    const long alloc_kb = atf_tc_get_config_var_as_long_wd(tc, "alloc_kb", 0);
+    const long sleep_ms = atf_tc_get_config_var_as_long_wd(tc, "sleep_ms", 0);
+
+    if (alloc_kb > 0) {
+        char *buf = malloc(alloc_kb * 1024);
+        long i;
+
+        ATF_REQUIRE(buf != NULL);
+        for (i = 0; i < alloc_kb * 1024; i += 1024)
+            ((volatile char *)buf)[i] = 1;  /* Keep the stores. */
+        free(buf);
+    }
+    if (sleep_ms > 0)
+        usleep(sleep_ms * 1000);
+}
+
 /* ---------------------------------------------------------------------
  * Helper tests for "t_srcdir".
  * --------------------------------------------------------------------- */
@@ -453,6 +534,10 @@ ATF_TC_BODY(result_newlines_skip, tc)
 
 ATF_TP_ADD_TCS(tp)
 {
+    /* Add helper tests for t_bench. */
+    ATF_TP_ADD_TC(tp, bench_loop);
+    ATF_TP_ADD_TC(tp, bench_no_head);
+
     /* Add helper tests for t_cleanup. */
     ATF_TP_ADD_TC(tp, cleanup_pass);
     ATF_TP_ADD_TC(tp, cleanup_fail);
@@ -489,6 +574,9 @@ ATF_TP_ADD_TCS(tp)
     ATF_TP_ADD_TC(tp, metadata_no_descr);
     ATF_TP_ADD_TC(tp, metadata_no_head);
 
+    /* Add helper tests for t_perf. */
+    ATF_TP_ADD_TC(tp, perf_limits);
+
     /* Add helper tests for t_srcdir. */
     ATF_TP_ADD_TC(tp, srcdir_exists);
 
@@ -28,6 +28,7 @@ extern "C" {
 #include <unistd.h>
 }
 
+#include <cstdio>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
@@ -36,6 +37,51 @@ extern "C" {
 
 #include "atf-c++/detail/fs.hpp"
 
+// ------------------------------------------------------------------------
+// Helper tests for "t_bench".
+// ------------------------------------------------------------------------
+
+ATF_BENCH(bench_loop);
+ATF_BENCH_HEAD(bench_loop)
+{
+    set_md_var("descr", "Helper benchmark for the t_bench test program");
+}
+ATF_BENCH_BODY(bench_loop, iterations)
+{
+    if (get_config_var("fail", "false") == "true")
+        ATF_FAIL("Failed on purpose");
+    volatile size_t sink = 0;
+    for (size_t i = 0; i < iterations; i++)
+        sink += i;
+}
+
+ATF_BENCH_WITHOUT_HEAD(bench_no_head);
+ATF_BENCH_BODY(bench_no_head, iterations)
+{
+    volatile size_t sink = 0;
+    for (size_t i = 0; i < iterations; i++)
+        sink += i;
+}
+
+// ------------------------------------------------------------------------
+// Helper tests for "t_cleanup".
+// ------------------------------------------------------------------------
+
+ATF_TEST_CASE_WITH_CLEANUP(cleanup_pass);
+ATF_TEST_CASE_HEAD(cleanup_pass)
+{
+    set_md_var("descr", "Helper test case for the t_cleanup test program");
+}
+ATF_TEST_CASE_BODY(cleanup_pass)
+{
+    std::ofstream os(get_config_var("tmpfile").c_str());
+}
+ATF_TEST_CASE_CLEANUP(cleanup_pass)
+{
+    if (get_config_var("cleanup", "no") == "yes")
+        std::remove(get_config_var("tmpfile").c_str());
+}
+
 // ------------------------------------------------------------------------
 // Helper tests for "t_config".
 // ------------------------------------------------------------------------
@@ -237,6 +283,24 @@ ATF_TEST_CASE_BODY(metadata_no_head)
 {
 }
 
+// ------------------------------------------------------------------------
+// Helper tests for "t_perf".
+// ------------------------------------------------------------------------
+
+ATF_TEST_CASE(perf_limits);
+ATF_TEST_CASE_HEAD(perf_limits)
+{
+    set_md_var("descr", "Helper test case for the t_perf test program");
+    if (has_config_var("X-perf.max_ms"))
+        set_md_var("X-perf.max_ms", get_config_var("X-perf.max_ms"));
+}
+ATF_TEST_CASE_BODY(perf_limits)
+{
+    const int sleep_ms = std::atoi(get_config_var("sleep_ms", "0").c_str());
+    if (sleep_ms > 0)
+        ::usleep(sleep_ms * 1000);
+}
+
 // ------------------------------------------------------------------------
 // Helper tests for "t_srcdir".
 // ------------------------------------------------------------------------
@@ -313,6 +377,13 @@ ATF_TEST_CASE_BODY(result_exception)
 
 ATF_INIT_TEST_CASES(tcs)
 {
+    // Add helper tests for t_bench.
+    ATF_ADD_TEST_CASE(tcs, bench_loop);
+    ATF_ADD_TEST_CASE(tcs, bench_no_head);
+
+    // Add helper tests for t_cleanup.
+    ATF_ADD_TEST_CASE(tcs, cleanup_pass);
+
     // Add helper tests for t_config.
     ATF_ADD_TEST_CASE(tcs, config_unset);
     ATF_ADD_TEST_CASE(tcs, config_empty);
@@ -342,6 +413,9 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, metadata_no_descr);
     ATF_ADD_TEST_CASE(tcs, metadata_no_head);
 
+    // Add helper tests for t_perf.
+    ATF_ADD_TEST_CASE(tcs, perf_limits);
+
     // Add helper tests for t_srcdir.
     ATF_ADD_TEST_CASE(tcs, srcdir_exists);
 
@@ -0,0 +1,121 @@
+# Copyright (c) 2026 The NetBSD Foundation, Inc.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+# 1. Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+# 2. Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#
+# THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+# CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+# INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+# IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+# DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+# GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+# INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+# IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+# IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+# Replaces the listing stored in a cache file, keeping its key, so that
+# reusing the cache is distinguishable from recomputing the listing.
+tamper_cache()
+{
+    head -n 1 "${1}" >cache.new
+    echo "fake listing" >>cache.new
+    mv cache.new "${1}"
+}
+
+atf_test_case reuse
+reuse_head()
+{
+    atf_set "descr" "Tests that -C stores the listing and reuses it on" \
+                    "subsequent invocations"
+}
+reuse_body()
+{
+    for h in $(get_helpers); do
+        cp "${h}" prog
+        ./prog -s . -l >expout
+
+        atf_check -s eq:0 -o file:expout -e empty ./prog -s . -l -C cache
+        test -f cache || atf_fail "Cache file not created"
+        atf_check -s eq:0 -o file:expout -e empty ./prog -s . -l -C cache
+
+        tamper_cache cache
+        atf_check -s eq:0 -o inline:"fake listing\n" -e empty \
+            ./prog -s . -l -C cache
+        rm cache prog
+    done
+}
+
+atf_test_case invalidate
+invalidate_head()
+{
+    atf_set "descr" "Tests that the cache is ignored and replaced when the" \
+                    "test program or its configuration change"
+}
+invalidate_body()
+{
+    for h in $(get_helpers); do
+        cp "${h}" prog
+        ./prog -s . -l >expout
+
+        atf_check -s eq:0 -o file:expout -e empty ./prog -s . -l -C cache
+        tamper_cache cache
+        atf_check -s eq:0 -o file:expout -e empty \
+            ./prog -s . -l -C cache -v foo=bar
+        tamper_cache cache
+        atf_check -s eq:0 -o file:expout -e empty ./prog -s . -l -C cache
+
+        tamper_cache cache
+        echo >>prog
+        atf_check -s eq:0 -o file:expout -e empty ./prog -s . -l -C cache
+        rm cache prog
+    done
+}
+
+atf_test_case unwritable
+unwritable_head()
+{
+    atf_set "descr" "Tests that failing to write the cache is not fatal"
+}
+unwritable_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers); do
+        "${h}" -s "${srcdir}" -l >expout
+        atf_check -s eq:0 -o file:expout -e match:"WARNING.*missing/cache" \
+            "${h}" -s "${srcdir}" -l -C missing/cache
+    done
+}
+
+atf_test_case usage_errors
+usage_errors_head()
+{
+    atf_set "descr" "Tests that -C is only accepted together with -l"
+}
+usage_errors_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers); do
+        atf_check -s eq:1 -o empty -e match:"-C can only be used together" \
+            "${h}" -s "${srcdir}" -C cache result_pass
+    done
+}
+
+atf_init_test_cases()
+{
+    atf_add_test_case reuse
+    atf_add_test_case invalidate
+    atf_add_test_case unwritable
+    atf_add_test_case usage_errors
+}
+
+# vim: syntax=sh:expandtab:shiftwidth=4:softtabstop=4
@@ -0,0 +1,151 @@
+# Copyright (c) 2026 The NetBSD Foundation, Inc.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+# 1. Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+# 2. Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#
+# THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+# CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+# INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+# IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+# DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+# GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+# INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+# IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+# IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+atf_test_case max_ms
+max_ms_head()
+{
+    atf_set "descr" "Tests that X-perf.max_ms fails test cases whose body" \
+                    "runs for too long"
+}
+max_ms_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers c_helpers cpp_helpers); do
+        atf_check -s eq:0 -o empty -e ignore "${h}" -s "${srcdir}" \
+            -v X-perf.max_ms=60000 -v sleep_ms=10 -r resfile perf_limits
+        atf_check -o inline:"passed\n" cat resfile
+
+        atf_check -s eq:1 -o empty -e ignore "${h}" -s "${srcdir}" \
+            -v X-perf.max_ms=10 -v sleep_ms=200 -r resfile perf_limits
+        atf_check -o match:"^failed: Performance regression: body took [0-9]+ ms; limit is 10 ms$" \
+            cat resfile
+    done
+}
+
+atf_test_case max_rss_kb
+max_rss_kb_head()
+{
+    atf_set "descr" "Tests that X-perf.max_rss_kb fails test cases that" \
+                    "use too much memory"
+}
+max_rss_kb_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers c_helpers); do
+        atf_check -s eq:0 -o empty -e ignore "${h}" -s "${srcdir}" \
+            -v X-perf.max_rss_kb=1000000 -r resfile perf_limits
+        atf_check -o inline:"passed\n" cat resfile
+
+        atf_check -s eq:1 -o empty -e ignore "${h}" -s "${srcdir}" \
+            -v X-perf.max_rss_kb=32768 -v alloc_kb=65536 -r resfile \
+            perf_limits
+        atf_check -o match:"^failed: Performance regression: maximum RSS" \
+            cat resfile
+    done
+}
+
+atf_test_case max_ns_per_op
+max_ns_per_op_head()
+{
+    atf_set "descr" "Tests that X-perf.max_ns_per_op fails benchmarks whose" \
+                    "iterations are too slow"
+}
+max_ns_per_op_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers c_helpers); do
+        atf_check -s eq:1 -o ignore -e ignore "${h}" -s "${srcdir}" \
+            -v X-perf.max_ns_per_op=1000 -v delay_us=100 \
+            -v atf.bench.time_ms=20 -v atf.usage=true -r resfile bench_loop
+        atf_check -o match:"^failed: Performance regression: benchmark took" \
+            cat resfile
+        test $(wc -l <resfile) -eq 1 || atf_fail "Unexpected results file"
+        atf_check -o match:"^bench: iterations=" -o match:"^usage: body " \
+            cat resfile.usage
+    done
+}
+
+atf_test_case baseline
+baseline_head()
+{
+    atf_set "descr" "Tests that limits are read from the X-perf.baseline" \
+                    "file and that meta-data properties take precedence"
+}
+baseline_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    printf '# Limits for perf_limits.\n\nmax_ms=10\n' >baseline
+    # Long lines must not be split in chunks that look like limits.
+    printf '#%02000d max_ms=1\n' 0 >>baseline
+    for h in $(get_helpers c_helpers); do
+        atf_check -s eq:1 -o empty -e ignore "${h}" -s "${srcdir}" \
+            -v X-perf.baseline="$(pwd)/baseline" -v sleep_ms=200 \
+            -r resfile perf_limits
+        atf_check -o match:"limit is 10 ms$" cat resfile
+
+        atf_check -s eq:0 -o empty -e ignore "${h}" -s "${srcdir}" \
+            -v X-perf.baseline="$(pwd)/baseline" -v X-perf.max_ms=60000 \
+            -v sleep_ms=200 -r resfile perf_limits
+        atf_check -o inline:"passed\n" cat resfile
+    done
+}
+
+atf_test_case invalid
+invalid_head()
+{
+    atf_set "descr" "Tests that invalid limits fail the test case"
+}
+invalid_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    echo "max_foo=3" >unknown
+    for h in $(get_helpers c_helpers); do
+        atf_check -s eq:1 -o empty -e ignore "${h}" -s "${srcdir}" \
+            -v X-perf.max_ms=abc -r resfile perf_limits
+        atf_check -o match:"^failed: Invalid value for performance limit" \
+            cat resfile
+
+        atf_check -s eq:1 -o empty -e ignore "${h}" -s "${srcdir}" \
+            -v X-perf.baseline="$(pwd)/unknown" -r resfile perf_limits
+        atf_check -o match:"^failed: Unknown performance limit 'max_foo'" \
+            cat resfile
+
+        atf_check -s eq:1 -o empty -e ignore "${h}" -s "${srcdir}" \
+            -v X-perf.baseline=missing -r resfile perf_limits
+        atf_check -o match:"^failed: Cannot open performance baseline" \
+            cat resfile
+    done
+}
+
+atf_init_test_cases()
+{
+    atf_add_test_case max_ms
+    atf_add_test_case max_rss_kb
+    atf_add_test_case max_ns_per_op
+    atf_add_test_case baseline
+    atf_add_test_case invalid
+}
+
+# vim: syntax=sh:expandtab:shiftwidth=4:softtabstop=4
@@ -110,6 +110,91 @@ result_to_file_fail_body()
     done
 }
 
+atf_test_case result_usage
+result_usage_head()
+{
+    atf_set "descr" "Tests that the resources consumed by the body are" \
+                    "recorded next to the results file if atf.usage is set"
+}
+result_usage_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers); do
+        rm -f resfile.usage
+        atf_check -s eq:0 -o inline:"msg\n" -e ignore "${h}" -s "${srcdir}" \
+            -r resfile result_pass
+        atf_check -o inline:"passed\n" cat resfile
+        test ! -f resfile.usage || atf_fail "Unexpected usage file"
+
+        atf_check -s eq:0 -o inline:"msg\n" -e ignore "${h}" -s "${srcdir}" \
+            -v atf.usage=true -r resfile result_pass
+        atf_check -o inline:"passed\n" cat resfile
+        atf_check \
+            -o match:"^usage: body wall=[0-9.]+ user=[0-9.]+ sys=[0-9.]+" \
+            cat resfile.usage
+        test $(wc -l <resfile.usage) -eq 1 || atf_fail "Unexpected usage file"
+
+        atf_check -s eq:1 -o inline:"msg\n" -e ignore "${h}" -s "${srcdir}" \
+            -v atf.usage=true -r resfile result_fail
+        atf_check -o inline:"failed: Failure reason\n" cat resfile
+        atf_check -o match:"^usage: body wall=" cat resfile.usage
+
+        atf_check -s eq:0 -o match:"^passed$" -o not-match:"^usage:" \
+            -e match:"^usage: body wall=" "${h}" -s "${srcdir}" \
+            -v atf.usage=true -r /dev/stdout result_pass
+    done
+
+    for h in $(get_helpers c_helpers cpp_helpers); do
+        atf_check -s eq:0 -o ignore -e ignore "${h}" -s "${srcdir}" \
+            -v atf.usage=true -r resfile result_pass
+        atf_check -o match:"maxrss=[0-9]+ minflt=[0-9]+ majflt=[0-9]+" \
+            -o match:"nvcsw=[0-9]+ nivcsw=[0-9]+$" cat resfile.usage
+    done
+}
+
+atf_test_case result_usage_expect
+result_usage_expect_head()
+{
+    atf_set "descr" "Tests that the resources consumed by the body are not" \
+                    "recorded when an expectation is set, only when the" \
+                    "test case reaches its final result"
+}
+result_usage_expect_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers); do
+        rm -f resfile.usage
+        atf_check -s eq:123 -o ignore -e ignore "${h}" -s "${srcdir}" \
+            -v atf.usage=true -r resfile expect_death_and_exit
+        atf_check -o match:"^expected_death: Exit case$" cat resfile
+        test ! -f resfile.usage || atf_fail "Usage recorded at expect time"
+    done
+}
+
+atf_test_case result_usage_cleanup
+result_usage_cleanup_head()
+{
+    atf_set "descr" "Tests that the resources consumed by the cleanup are" \
+                    "appended to the usage file if atf.usage is set"
+}
+result_usage_cleanup_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers); do
+        atf_check -s eq:0 -o ignore -e ignore "${h}" -s "${srcdir}" \
+            -v atf.usage=true -v tmpfile=foo -v cleanup=yes \
+            -r resfile cleanup_pass
+        atf_check -s eq:0 -o ignore -e ignore "${h}" -s "${srcdir}" \
+            -v atf.usage=true -v tmpfile=foo -v cleanup=yes \
+            -r resfile cleanup_pass:cleanup
+        test ! -f foo || atf_fail "Cleanup did not run"
+        atf_check -o inline:"passed\n" cat resfile
+        atf_check -o match:"^usage: body wall=" \
+            -o match:"^usage: cleanup wall=" cat resfile.usage
+        rm resfile resfile.usage
+    done
+}
+
 atf_test_case result_exception
 result_exception_head()
 {
@@ -129,6 +214,9 @@ atf_init_test_cases()
     atf_add_test_case result_on_stdout
     atf_add_test_case result_to_file
     atf_add_test_case result_to_file_fail
+    atf_add_test_case result_usage
+    atf_add_test_case result_usage_expect
+    atf_add_test_case result_usage_cleanup
     atf_add_test_case result_exception
 }
 
@@ -0,0 +1,156 @@
+# Copyright (c) 2026 The NetBSD Foundation, Inc.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+# 1. Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+# 2. Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#
+# THIS SOFTWARE IS PROVIDED BY THE NETBSD FOUNDATION, INC. AND
+# CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES,
+# INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+# IN NO EVENT SHALL THE FOUNDATION OR CONTRIBUTORS BE LIABLE FOR ANY
+# DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+# GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+# INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+# IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+# IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+atf_test_case run_commands
+run_commands_head()
+{
+    atf_set "descr" "Tests that -S runs the test cases requested on stdin" \
+                    "and replies with their termination status"
+}
+run_commands_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    mkdir work1 work2
+    cat >commands <<EOF
+run result_pass resfile1 work1
+run result_fail resfile2 work2 stdout2 stderr2
+EOF
+    for h in $(get_helpers c_helpers); do
+        atf_check -s eq:0 -o inline:"exit(0)\nexit(1)\n" -e match:"^msg$" \
+            "${h}" -s "${srcdir}" -S <commands
+        atf_check -o inline:"passed\n" cat resfile1
+        atf_check -o inline:"failed: Failure reason\n" cat resfile2
+        atf_check -o inline:"msg\n" cat stdout2
+    done
+}
+
+atf_test_case workdir
+workdir_head()
+{
+    atf_set "descr" "Tests that the test cases run by -S enter the" \
+                    "requested work directory"
+}
+workdir_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    mkdir work
+    echo "run cleanup_pass resfile work" >commands
+    for h in $(get_helpers c_helpers); do
+        atf_check -s eq:0 -o inline:"exit(0)\n" -e ignore "${h}" \
+            -s "${srcdir}" -v tmpfile=foo -S <commands
+        test -f work/foo || atf_fail "Test case did not run in work"
+        rm work/foo
+    done
+}
+
+atf_test_case quoting
+quoting_head()
+{
+    atf_set "descr" "Tests that the paths given to -S can be quoted to" \
+                    "contain spaces and other special characters"
+}
+quoting_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    mkdir "work dir" "it's"
+    cat >commands <<'EOF'
+# Comments and empty lines are ignored.
+
+run result_pass 'result file' "work dir" out\ file $'err\tfile'
+run cleanup_pass "it's/result" it\'s  # Trailing comment.
+EOF
+    for h in $(get_helpers c_helpers); do
+        atf_check -s eq:0 -o inline:"exit(0)\nexit(0)\n" -e ignore "${h}" \
+            -s "${srcdir}" -v tmpfile=foo -S <commands
+        atf_check -o inline:"passed\n" cat "result file"
+        atf_check -o inline:"msg\n" cat "out file"
+        atf_check -o empty cat "$(printf 'err\tfile')"
+        atf_check -o inline:"passed\n" cat "it's/result"
+        test -f "it's/foo" || atf_fail "Test case did not run in it's"
+        rm "it's/foo"
+    done
+
+    echo "run result_pass 'resfile work" >commands
+    for h in $(get_helpers c_helpers); do
+        atf_check -s eq:0 -o match:"^error: Unterminated quote" \
+            -e ignore "${h}" -s "${srcdir}" -S <commands
+    done
+}
+
+atf_test_case errors
+errors_head()
+{
+    atf_set "descr" "Tests that invalid commands are reported without" \
+                    "stopping the server"
+}
+errors_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    mkdir work
+    cat >commands <<EOF
+foo bar
+run unknown resfile work
+run result_pass
+quit
+run result_pass resfile work
+EOF
+    cat >expout <<EOF
+error: Unknown command \`foo bar'
+error: Unknown test case \`unknown'
+error: run takes 3 or 5 arguments; got 1
+EOF
+    for h in $(get_helpers c_helpers); do
+        atf_check -s eq:0 -o file:expout -e ignore "${h}" -s "${srcdir}" \
+            -S <commands
+        test ! -f resfile || atf_fail "Command after quit was executed"
+    done
+}
+
+atf_test_case usage_errors
+usage_errors_head()
+{
+    atf_set "descr" "Tests the usage errors of server mode"
+}
+usage_errors_body()
+{
+    srcdir="$(atf_get_srcdir)"
+    for h in $(get_helpers c_helpers); do
+        atf_check -s eq:1 -o empty -e match:"test case names with -S" \
+            "${h}" -s "${srcdir}" -S result_pass
+        atf_check -s eq:1 -o empty -e match:"cannot be combined" \
+            "${h}" -s "${srcdir}" -S -l
+    done
+}
+
+atf_init_test_cases()
+{
+    atf_add_test_case run_commands
+    atf_add_test_case workdir
+    atf_add_test_case quoting
+    atf_add_test_case errors
+    atf_add_test_case usage_errors
+}
+
+# vim: syntax=sh:expandtab:shiftwidth=4:softtabstop=4